@@ -10,6 +10,7 @@
 
 #include "texturebin.h"
 #include "3ds.h"
+#include "mappedfile.h"
 
 // ----------------------------------------------------------------------------
 
@@ -81,13 +82,18 @@ int	C3DS::load(const char *inName, sD3DS *info)
 	targetNodeList  = info->targetNodeList;
 	lightNodeList   = info->lightNodeList;
 
-	FILE	*inFile = fopen(inName, "rb");
+	// The whole file is mapped, and the chunks are read straight out of it
 
-	if (!inFile) throw std::string("Unable to open input scene file: ").append(inName);
+	MappedFile	file;
 
-	if (!read3DS(inFile))
+	if (!file.open(inName)) throw std::string("Unable to open input scene file: ").append(inName);
+
+	sBUF	buf;
+	buf.pos = file.data();
+	buf.end = file.data() + file.size();
+
+	if (!read3DS(&buf))
 	{
-		fclose(inFile);
 		return 0;
 	}
 
@@ -147,13 +153,137 @@ int	C3DS::load(const char *inName, sD3DS *info)
 		SWAP(lightList[i].target.y, lightList[i].target.z, fTemp);
 	}
 
-	fclose(inFile);
 	return 1;
 }
 
+// ----------------------------------------------------------------------------
+// Writes a copy of 'inName' to 'outName' with the face lists of its meshes
+// replaced by the ones in 'info' (which must have been loaded from 'inName'.)
+// This is for saving meshes that were modified after loading (i.e. welded.)
+// Only the vertex indices are replaced, so nothing else about the file
+// changes -- the face counts must be the same as they were.
+// ----------------------------------------------------------------------------
+
+int	C3DS::saveFaceLists(const char *inName, const char *outName, const sD3DS *info)
+{
+	// Copy the whole file
+
+	MappedFile	file;
+
+	if (!file.open(inName)) throw std::string("Unable to open input scene file: ").append(inName);
+
+	if (!file.size()) throw std::string("Unable to read input scene file: ").append(inName);
+
+	unsigned int			length = file.size();
+	std::vector<unsigned char>	buffer(file.data(), file.data() + length);
+	file.close();
+
+	// Replace the face lists
+
+	int	meshIndex = -1;
+	patchFaceLists(&buffer[0], &buffer[0] + length, info, meshIndex);
+
+	if (meshIndex + 1 != info->meshCount)
+	{
+		throw std::string("Scene file doesn't match the loaded meshes: ").append(inName);
+	}
+
+	// Write it back out
+
+	FILE	*outFile = fopen(outName, "wb");
+
+	if (!outFile) throw std::string("Unable to create scene file: ").append(outName);
+
+	int	ok = fwrite(&buffer[0], length, 1, outFile) == 1;
+	if (fclose(outFile)) ok = 0;
+
+	if (!ok) throw std::string("Unable to write scene file: ").append(outName);
+
+	return 1;
+}
+
+// ----------------------------------------------------------------------------
+// Walks the chunks in [start, end) the same way the loader does, replacing
+// the vertex indices of each mesh's face list. 'meshIndex' is the index of the
+// current mesh (in the order they were loaded.)
+// ----------------------------------------------------------------------------
+
+void	C3DS::patchFaceLists(unsigned char *start, unsigned char *end, const sD3DS *info, int &meshIndex)
+{
+	unsigned char	*chunk = start;
+
+	while (end - chunk >= CHUNK_HEADER_SIZE)
+	{
+		unsigned short	id;
+		unsigned int	length;
+		memcpy(&id, chunk, sizeof(id));
+		memcpy(&length, chunk + sizeof(id), sizeof(length));
+
+		if (length < CHUNK_HEADER_SIZE || length > (unsigned int) (end - chunk))
+		{
+			throw std::string("Invalid chunk length in scene file");
+		}
+
+		unsigned char	*data = chunk + CHUNK_HEADER_SIZE;
+		unsigned char	*next = chunk + length;
+
+		switch(id)
+		{
+			case CHUNK_3DSFILE:
+			case CHUNK_MLIFILE:
+			case CHUNK_PRJFILE:
+			case CHUNK_MESH:
+				patchFaceLists(data, next, info, meshIndex);
+				break;
+
+			case CHUNK_NAMEDOBJECT:
+				// Skip the name
+
+				while (data < next && *data) data++;
+				if (data < next) patchFaceLists(data + 1, next, info, meshIndex);
+				break;
+
+			case CHUNK_TRIMESH:
+				meshIndex++;
+				patchFaceLists(data, next, info, meshIndex);
+				break;
+
+			case CHUNK_FACELIST:
+			{
+				if (meshIndex < 0 || meshIndex >= info->meshCount)
+				{
+					throw std::string("Face list outside of a mesh in scene file");
+				}
+
+				const sMSH	&mesh = info->mesh[meshIndex];
+				unsigned short	count = 0;
+				if (next - data >= (int) sizeof(count)) memcpy(&count, data, sizeof(count));
+
+				if (count != mesh.fCount || next - data < (int) sizeof(count) + count * 4 * (int) sizeof(unsigned short))
+				{
+					throw std::string("Scene file doesn't match the loaded meshes");
+				}
+
+				unsigned char	*face = data + sizeof(count);
+
+				for( int i = 0; i < count; i++, face += 4 * sizeof(unsigned short) )
+				{
+					// Undo the a/b swap that load() does
+
+					unsigned short	indices[3] = {mesh.fList[i].b, mesh.fList[i].a, mesh.fList[i].c};
+					memcpy(face, indices, sizeof(indices));
+				}
+				break;
+			}
+		}
+
+		chunk = next;
+	}
+}
+
 // ----------------------------------------------------------------------------
 
-int	C3DS::read3DS(FILE *inFile)
+int	C3DS::read3DS(sBUF *inFile)
 {
 	// Get the first chunk... verify the integrity of the file...
 
@@ -174,22 +304,36 @@ int	C3DS::read3DS(FILE *inFile)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::getChunkID(FILE *file, sCHK *chunk)
+int	C3DS::getChunkID(sBUF *buf, sCHK *chunk)
 {
-	return myRead( chunk, sizeof(sCHK), file );
+	// On disk, it's a 16-bit ID followed by a 32-bit length
+
+	unsigned short	id;
+	unsigned int	length;
+
+	if (buf->end - buf->pos < CHUNK_HEADER_SIZE)
+		return 0;
+
+	memcpy(&id, buf->pos, sizeof(id));
+	memcpy(&length, buf->pos + sizeof(id), sizeof(length));
+	buf->pos += CHUNK_HEADER_SIZE;
+
+	chunk->ID = id;
+	chunk->length = length;
+	return 1;
 }
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::process3DS(FILE *inFile, int chunkLength)
+int	C3DS::process3DS(sBUF *inFile, int chunkLength)
 {
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
@@ -236,23 +380,27 @@ int	C3DS::process3DS(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMeshChunk(FILE *inFile, int chunkLength)
+int	C3DS::readMeshChunk(sBUF *inFile, int chunkLength)
 {
 	#ifdef	DEBUG_INFO
 	printf( "Mesh chunk\n" );
 	#endif
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
 
+		// Are we done?
+
+		if (!retCode) break;
+
 		// Make sure it's a sub-chunk...
 
 		if (chunk.ID >> 12 >= 0xB || chunk.ID == CHUNK_MESH)
@@ -261,10 +409,6 @@ int	C3DS::readMeshChunk(FILE *inFile, int chunkLength)
 			return 1;
 		}
 
-		// Are we done?
-
-		if (!retCode) break;
-
 		switch(chunk.ID)
 		{
 			case CHUNK_NAMEDOBJECT:
@@ -296,19 +440,19 @@ int	C3DS::readMeshChunk(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readKeyframeChunk(FILE *inFile, int chunkLength)
+int	C3DS::readKeyframeChunk(sBUF *inFile, int chunkLength)
 {
 	#ifdef	DEBUG_INFO
 	printf( "KeyframeChunk\n" );
 	#endif
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
@@ -399,7 +543,7 @@ int	C3DS::readKeyframeChunk(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readKeyframeHeader( FILE *inFile, int chunkLength )
+int	C3DS::readKeyframeHeader( sBUF *inFile, int chunkLength )
 {
 	#ifdef	DEBUG_INFO
 	printf( "KeyframeHeader\n" );
@@ -421,7 +565,7 @@ int	C3DS::readKeyframeHeader( FILE *inFile, int chunkLength )
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readObjectNode( FILE *inFile, int chunkLength )
+int	C3DS::readObjectNode( sBUF *inFile, int chunkLength )
 {
 	#ifdef	DEBUG_INFO
 	printf( "ObjectNode\n" );
@@ -436,13 +580,13 @@ int	C3DS::readObjectNode( FILE *inFile, int chunkLength )
 
 	tempNode = &objectNodeList[objectNodeCount];
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
@@ -622,7 +766,7 @@ int	C3DS::readObjectNode( FILE *inFile, int chunkLength )
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readCameraNode( FILE *inFile, int chunkLength )
+int	C3DS::readCameraNode( sBUF *inFile, int chunkLength )
 {
 	#ifdef	DEBUG_INFO
 	printf( "CameraNode\n" );
@@ -637,13 +781,13 @@ int	C3DS::readCameraNode( FILE *inFile, int chunkLength )
 
 	tempNode = &cameraNodeList[cameraNodeCount];
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
@@ -791,7 +935,7 @@ int	C3DS::readCameraNode( FILE *inFile, int chunkLength )
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readTargetNode( FILE *inFile, int chunkLength )
+int	C3DS::readTargetNode( sBUF *inFile, int chunkLength )
 {
 	#ifdef	DEBUG_INFO
 	printf( "TargetNode\n" );
@@ -806,13 +950,13 @@ int	C3DS::readTargetNode( FILE *inFile, int chunkLength )
 
 	tempNode = &targetNodeList[targetNodeCount];
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
@@ -894,7 +1038,7 @@ int	C3DS::readTargetNode( FILE *inFile, int chunkLength )
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readLightNode( FILE *inFile, int chunkLength )
+int	C3DS::readLightNode( sBUF *inFile, int chunkLength )
 {
 	#ifdef	DEBUG_INFO
 	printf( "LightNode\n" );
@@ -909,13 +1053,13 @@ int	C3DS::readLightNode( FILE *inFile, int chunkLength )
 
 	tempNode = &lightNodeList[lightNodeCount];
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
@@ -1023,7 +1167,7 @@ int	C3DS::readLightNode( FILE *inFile, int chunkLength )
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterial(FILE *inFile, int chunkLength)
+int	C3DS::readMaterial(sBUF *inFile, int chunkLength)
 {
 	#ifdef	DEBUG_INFO
 	printf( "Material\n" );
@@ -1038,17 +1182,21 @@ int	C3DS::readMaterial(FILE *inFile, int chunkLength)
 
 	memset( &matList[matCount], 0, sizeof(sMAT) );
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
 
+		// Are we done?
+
+		if (!retCode) break;
+
 		// Make sure it's a sub-chunk...
 
 		if ((chunk.ID >> 12 != 0xA && chunk.ID >> 12) || chunk.ID == CHUNK_MATERIAL)
@@ -1057,10 +1205,6 @@ int	C3DS::readMaterial(FILE *inFile, int chunkLength)
 			break;
 		}
 
-		// Are we done?
-
-		if (!retCode) break;
-
 		switch(chunk.ID)
 		{
 			case CHUNK_MATNAME:
@@ -1122,7 +1266,7 @@ int	C3DS::readMaterial(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterialName(FILE *inFile, int chunkLength)
+int	C3DS::readMaterialName(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1135,7 +1279,7 @@ int	C3DS::readMaterialName(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterialAmbient(FILE *inFile, int chunkLength)
+int	C3DS::readMaterialAmbient(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1158,7 +1302,7 @@ int	C3DS::readMaterialAmbient(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterialColor(FILE *inFile, int chunkLength)
+int	C3DS::readMaterialColor(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1181,7 +1325,7 @@ int	C3DS::readMaterialColor(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterialShine(FILE *inFile, int chunkLength)
+int	C3DS::readMaterialShine(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1207,7 +1351,7 @@ int	C3DS::readMaterialShine(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterialTrans(FILE *inFile, int chunkLength)
+int	C3DS::readMaterialTrans(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1233,7 +1377,7 @@ int	C3DS::readMaterialTrans(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterialTexture(FILE *inFile, int chunkLength)
+int	C3DS::readMaterialTexture(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1258,9 +1402,9 @@ int	C3DS::readMaterialTexture(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readNamedObject(FILE *inFile, int chunkLength)
+int	C3DS::readNamedObject(sBUF *inFile, int chunkLength)
 {
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	if (!getString( inFile, currentNamedObject ))
 		return 0;
@@ -1273,11 +1417,15 @@ int	C3DS::readNamedObject(FILE *inFile, int chunkLength)
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
 
+		// Are we done?
+
+		if (!retCode) break;
+
 		// Make sure it's a sub-chunk...
 
 		if (chunk.ID >> 12 != 4 || chunk.ID == CHUNK_NAMEDOBJECT )
@@ -1286,10 +1434,6 @@ int	C3DS::readNamedObject(FILE *inFile, int chunkLength)
 			break;
 		}
 
-		// Are we done?
-
-		if (!retCode) break;
-
 		switch(chunk.ID)
 		{
 			case CHUNK_TRIMESH:
@@ -1335,7 +1479,7 @@ int	C3DS::readNamedObject(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readTriMesh(FILE *inFile, int chunkLength)
+int	C3DS::readTriMesh(sBUF *inFile, int chunkLength)
 {
 	#ifdef	DEBUG_INFO
 	printf( "TriMesh\n" );
@@ -1352,17 +1496,21 @@ int	C3DS::readTriMesh(FILE *inFile, int chunkLength)
 
 	strcpy(meshList[meshCount].name, currentNamedObject );
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	FOREVER
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
 
+		// Are we done?
+
+		if (!retCode) break;
+
 		// Make sure it's a sub-chunk...
 
 		if (chunk.ID >> 8 != 0x41 || chunk.ID == CHUNK_TRIMESH )
@@ -1371,10 +1519,6 @@ int	C3DS::readTriMesh(FILE *inFile, int chunkLength)
 			break;
 		}
 
-		// Are we done?
-
-		if (!retCode) break;
-
 		switch(chunk.ID)
 		{
 			case CHUNK_VERTEXLIST:
@@ -1421,7 +1565,7 @@ int	C3DS::readTriMesh(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readVertexList(FILE *inFile, int chunkLength)
+int	C3DS::readVertexList(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1451,7 +1595,7 @@ int	C3DS::readVertexList(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readFaceList(FILE *inFile, int chunkLength)
+int	C3DS::readFaceList(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1473,29 +1617,18 @@ int	C3DS::readFaceList(FILE *inFile, int chunkLength)
 
 	memset( meshList[meshCount].fList, 0, sizeof(sFACE) * meshList[meshCount].fCount );
 
-	for( int i = 0; i < meshList[meshCount].fCount; i++)
-	{
-		meshList[meshCount].fList[i].materialIndex = 0;
-
-		if (!myRead( &meshList[meshCount].fList[i].a, sizeof(unsigned short), inFile ))
-		{
-			throw std::string("Unable to read vertex index");
-		}
+	// Each face is stored as a, b, c, flags -- the same as the start of an sFACE
 
-		if (!myRead( &meshList[meshCount].fList[i].b, sizeof(unsigned short), inFile ))
-		{
-			throw std::string("Unable to read vertex index");
-		}
+	const int	faceSize = 4 * sizeof(unsigned short);
 
-		if (!myRead( &meshList[meshCount].fList[i].c, sizeof(unsigned short), inFile ))
-		{
-			throw std::string("Unable to read vertex index");
-		}
+	if (inFile->end - inFile->pos < meshList[meshCount].fCount * faceSize)
+	{
+		throw std::string("Unable to read vertex index");
+	}
 
-		if (!myRead( &meshList[meshCount].fList[i].flags, sizeof(unsigned short), inFile ))
-		{
-			throw std::string("Unable to read flags");
-		}
+	for( int i = 0; i < meshList[meshCount].fCount; i++, inFile->pos += faceSize)
+	{
+		memcpy( &meshList[meshCount].fList[i].a, inFile->pos, faceSize );
 	}
 
 	return 1;
@@ -1503,7 +1636,7 @@ int	C3DS::readFaceList(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMaterialApp(FILE *inFile, int chunkLength)
+int	C3DS::readMaterialApp(sBUF *inFile, int chunkLength)
 {
 	#ifdef	DEBUG_INFO
 	printf( "MaterialApp\n" );
@@ -1540,6 +1673,13 @@ int	C3DS::readMaterialApp(FILE *inFile, int chunkLength)
 		throw std::string("Unable to find material in list");
 	}
 
+	// The face list must come first, or there is nothing to apply the material to
+
+	if (!meshList[meshCount].fList)
+	{
+		throw std::string("Material application before mesh face list");
+	}
+
 	int	count = (chunkLength - CHUNK_HEADER_SIZE - (int) strlen(name) - 3) / 2;
 
 	while( count-- )
@@ -1549,7 +1689,7 @@ int	C3DS::readMaterialApp(FILE *inFile, int chunkLength)
 			throw std::string("Unable to read material application face number");
 		}
 
-		if (faceNumber > meshList[meshCount].fCount)
+		if (faceNumber >= meshList[meshCount].fCount)
 		{
 			throw std::string("Material application face number out of range");
 		}
@@ -1562,7 +1702,7 @@ int	C3DS::readMaterialApp(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readUVList(FILE *inFile, int chunkLength)
+int	C3DS::readUVList(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1604,7 +1744,7 @@ int	C3DS::readUVList(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readLight(FILE *inFile, int chunkLength)
+int	C3DS::readLight(sBUF *inFile, int chunkLength)
 {
 	lightList = (sLGT *) realloc( lightList, (lightCount+1) * sizeof(sLGT) );
 
@@ -1620,7 +1760,7 @@ int	C3DS::readLight(FILE *inFile, int chunkLength)
 	lightList[lightCount].outerRange = 100.0f;
 	lightList[lightCount].intensity  = 1.0f;
 
-	int	endPos = chunkLength - CHUNK_HEADER_SIZE + ftell(inFile);
+	const unsigned char	*endPos = chunkEnd(inFile, chunkLength);
 
 	#ifdef	DEBUG_INFO
 	printf( "Light\n" );
@@ -1635,11 +1775,15 @@ int	C3DS::readLight(FILE *inFile, int chunkLength)
 	{
 		// Done?
 
-		if (endPos <= ftell(inFile)) break;
+		if (endPos <= inFile->pos) break;
 
 		sCHK	chunk;
 		int	retCode = getChunkID(inFile, &chunk);
 
+		// Are we done?
+
+		if (!retCode) break;
+
 		// Make sure it's a sub-chunk...
 
 		if ((chunk.ID >> 8 != 0x46 && chunk.ID >> 8 != 0x00) || chunk.ID == CHUNK_LIGHT )
@@ -1648,10 +1792,6 @@ int	C3DS::readLight(FILE *inFile, int chunkLength)
 			break;
 		}
 
-		// Are we done?
-
-		if (!retCode) break;
-
 		switch(chunk.ID)
 		{
 			case CHUNK_RGB:
@@ -1719,7 +1859,7 @@ int	C3DS::readLight(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readLightRGB(FILE *inFile, int chunkLength)
+int	C3DS::readLightRGB(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1750,7 +1890,7 @@ int	C3DS::readLightRGB(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readLight24Bit(FILE *inFile, int chunkLength)
+int	C3DS::readLight24Bit(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1770,7 +1910,7 @@ int	C3DS::readLight24Bit(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readSpotLight(FILE *inFile, int chunkLength)
+int	C3DS::readSpotLight(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1800,7 +1940,7 @@ int	C3DS::readSpotLight(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readNoLight(FILE *inFile, int chunkLength)
+int	C3DS::readNoLight(sBUF *inFile, int chunkLength)
 {
 	#ifdef	DEBUG_INFO
 	printf( "NoLight\n" );
@@ -1817,7 +1957,7 @@ int	C3DS::readNoLight(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readInnerRange(FILE *inFile, int chunkLength)
+int	C3DS::readInnerRange(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1835,7 +1975,7 @@ int	C3DS::readInnerRange(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readOuterRange(FILE *inFile, int chunkLength)
+int	C3DS::readOuterRange(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1853,7 +1993,7 @@ int	C3DS::readOuterRange(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readMultiplier(FILE *inFile, int chunkLength)
+int	C3DS::readMultiplier(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1871,7 +2011,7 @@ int	C3DS::readMultiplier(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::readCamera(FILE *inFile, int chunkLength)
+int	C3DS::readCamera(sBUF *inFile, int chunkLength)
 {
 	chunkLength = chunkLength;
 
@@ -1914,42 +2054,56 @@ int	C3DS::readCamera(FILE *inFile, int chunkLength)
 
 // ----------------------------------------------------------------------------
 
-void	C3DS::skipChunk(FILE *File, unsigned long length)
+const unsigned char	*C3DS::chunkEnd(const sBUF *buf, unsigned long length)
 {
-	fseek( File, length + ftell(File) - CHUNK_HEADER_SIZE, SEEK_SET );
+	// The end of the chunk whose header was just read (never past the end
+	// of the file, so a bad length can't send us off into the weeds)
+
+	unsigned long	remaining = (unsigned long) (buf->end - buf->pos);
+
+	if (length < CHUNK_HEADER_SIZE || length - CHUNK_HEADER_SIZE > remaining)
+		return buf->end;
+
+	return buf->pos + length - CHUNK_HEADER_SIZE;
 }
 
 // ----------------------------------------------------------------------------
 
-void	C3DS::backup(FILE *File)
+void	C3DS::skipChunk(sBUF *buf, unsigned long length)
 {
-	fseek( File, ftell(File) - CHUNK_HEADER_SIZE, SEEK_SET );
+	buf->pos = chunkEnd(buf, length);
 }
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::myRead( void *buffer, int length, FILE *file)
+void	C3DS::backup(sBUF *buf)
 {
-	int	Count = (int) fread(buffer, length, 1, file);
+	buf->pos -= CHUNK_HEADER_SIZE;
+}
+
+// ----------------------------------------------------------------------------
 
-	if (Count == 0 && feof(file))
+int	C3DS::myRead( void *buffer, int length, sBUF *buf)
+{
+	if (buf->end - buf->pos < length)
 		return 0;
 
-	if (Count != 1)
-	{
-		throw std::string("Unable to read from input file");
-	}
+	memcpy(buffer, buf->pos, length);
+	buf->pos += length;
 
 	return 1;
 }
 
 // ----------------------------------------------------------------------------
 
-int	C3DS::getString( FILE *inFile, char *string )
+int	C3DS::getString( sBUF *inFile, char *string )
 {
 	for( int i = 0; i < DEF_STR_LEN; i++)
 	{
-		int	chr = fgetc(inFile);
+		if (inFile->pos >= inFile->end)
+			return 0;
+
+		int	chr = *(inFile->pos++);
 
 		if (chr == ' ')
 			chr = '_';
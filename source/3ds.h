@@ -407,6 +407,17 @@ typedef struct
 
 #pragma pack()
 
+// ----------------------------------------------------------------------------
+// The part of the (memory mapped) input file that's left to read
+
+typedef struct
+{
+	const unsigned char	*pos;
+	const unsigned char	*end;
+} sBUF;
+
+// ----------------------------------------------------------------------------
+
 class	C3DS
 {
 private:
@@ -494,52 +505,57 @@ private:
 	sTGTNODE	*targetNodeList;
 	sLGTNODE	*lightNodeList;
 
-	int		read3DS(FILE *InFile);
-	int		process3DS(FILE *InFile, int ChunkLength);
-	int		readAmbientColor(FILE *InFile, int ChunkLength);	
-	int		readMeshChunk(FILE *InFile, int ChunkLength);
-	int		readMaterial(FILE *InFile, int ChunkLength);
-	int		readMaterialName(FILE *InFile, int ChunkLength);
-	int		readMaterialAmbient(FILE *InFile, int ChunkLength);
-	int		readMaterialColor(FILE *InFile, int ChunkLength);
-	int		readMaterialShine(FILE *InFile, int ChunkLength);
-	int		readMaterialTrans(FILE *InFile, int ChunkLength);
-	int		readMaterialTexture(FILE *InFile, int ChunkLength);
-	int		readKeyframeChunk(FILE *InFile, int ChunkLength);
-	int		readKeyframeHeader(FILE *InFile, int ChunkLength);
-	int		readObjectNode(FILE *InFile, int ChunkLength);
-	int		readCameraNode(FILE *InFile, int ChunkLength);
-	int		readTargetNode(FILE *InFile, int ChunkLength);
-	int		readLightNode(FILE *InFile, int ChunkLength);
-	int		readNamedObject(FILE *InFile, int ChunkLength);
-	int		readTriMesh(FILE *InFile, int ChunkLength);
-	int		readVertexList(FILE *InFile, int ChunkLength);
-	int		readFaceList(FILE *InFile, int ChunkLength);
-	int		readMaterialApp(FILE *InFile, int ChunkLength);
-	int		readUVList(FILE *InFile, int ChunkLength);
-	int		readTranslationMatrix(FILE *InFile, int ChunkLength);
-	int		readLight(FILE *InFile, int ChunkLength);
-	int		readLightRGB(FILE *InFile, int ChunkLength);
-	int		readLight24Bit(FILE *InFile, int ChunkLength);
-	int		readRGB(FILE *InFile, int ChunkLength);
-	int		read24Bit(FILE *InFile, int ChunkLength);
-	int		readSpotLight(FILE *InFile, int ChunkLength);
-	int		readNoLight(FILE *InFile, int ChunkLength);
-	int		readInnerRange(FILE *inFile, int chunkLength);
-	int		readOuterRange(FILE *inFile, int chunkLength);
-	int		readMultiplier(FILE *inFile, int chunkLength);
-	int		readCamera(FILE *InFile, int ChunkLength);
-	int		getChunkID(FILE *File, sCHK *Chunk);
-	void		skipChunk(FILE *File, unsigned long Length);
-	void		backup(FILE *File);
-	int		myRead(void *Buffer, int Length, FILE *File);
-	int		getString(FILE *InFile, char *String);
+	int		read3DS(sBUF *InFile);
+	int		process3DS(sBUF *InFile, int ChunkLength);
+	int		readAmbientColor(sBUF *InFile, int ChunkLength);	
+	int		readMeshChunk(sBUF *InFile, int ChunkLength);
+	int		readMaterial(sBUF *InFile, int ChunkLength);
+	int		readMaterialName(sBUF *InFile, int ChunkLength);
+	int		readMaterialAmbient(sBUF *InFile, int ChunkLength);
+	int		readMaterialColor(sBUF *InFile, int ChunkLength);
+	int		readMaterialShine(sBUF *InFile, int ChunkLength);
+	int		readMaterialTrans(sBUF *InFile, int ChunkLength);
+	int		readMaterialTexture(sBUF *InFile, int ChunkLength);
+	int		readKeyframeChunk(sBUF *InFile, int ChunkLength);
+	int		readKeyframeHeader(sBUF *InFile, int ChunkLength);
+	int		readObjectNode(sBUF *InFile, int ChunkLength);
+	int		readCameraNode(sBUF *InFile, int ChunkLength);
+	int		readTargetNode(sBUF *InFile, int ChunkLength);
+	int		readLightNode(sBUF *InFile, int ChunkLength);
+	int		readNamedObject(sBUF *InFile, int ChunkLength);
+	int		readTriMesh(sBUF *InFile, int ChunkLength);
+	int		readVertexList(sBUF *InFile, int ChunkLength);
+	int		readFaceList(sBUF *InFile, int ChunkLength);
+	int		readMaterialApp(sBUF *InFile, int ChunkLength);
+	int		readUVList(sBUF *InFile, int ChunkLength);
+	int		readTranslationMatrix(sBUF *InFile, int ChunkLength);
+	int		readLight(sBUF *InFile, int ChunkLength);
+	int		readLightRGB(sBUF *InFile, int ChunkLength);
+	int		readLight24Bit(sBUF *InFile, int ChunkLength);
+	int		readRGB(sBUF *InFile, int ChunkLength);
+	int		read24Bit(sBUF *InFile, int ChunkLength);
+	int		readSpotLight(sBUF *InFile, int ChunkLength);
+	int		readNoLight(sBUF *InFile, int ChunkLength);
+	int		readInnerRange(sBUF *inFile, int chunkLength);
+	int		readOuterRange(sBUF *inFile, int chunkLength);
+	int		readMultiplier(sBUF *inFile, int chunkLength);
+	int		readCamera(sBUF *InFile, int ChunkLength);
+	int		getChunkID(sBUF *Buf, sCHK *Chunk);
+	const unsigned char	*chunkEnd(const sBUF *Buf, unsigned long Length);
+	void		skipChunk(sBUF *Buf, unsigned long Length);
+	void		backup(sBUF *Buf);
+	int		myRead(void *Buffer, int Length, sBUF *Buf);
+	int		getString(sBUF *InFile, char *String);
 
 public:
 			C3DS();
 			~C3DS();
 
 	int		load(const char *InName, sD3DS *Info);
+	int		saveFaceLists(const char *InName, const char *OutName, const sD3DS *Info);
+
+private:
+	void		patchFaceLists(unsigned char *Start, unsigned char *End, const sD3DS *Info, int &MeshIndex);
 };
 
 #endif
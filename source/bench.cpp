@@ -0,0 +1,800 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____                  _                          
+// |  _ \                | |                         
+// | |_) | ___ _ __   ___| |__       ___ _ __  _ __  
+// |  _ < / _ \ '_ \ / __| '_ \     / __| '_ \| '_ \ 
+// | |_) |  __/ | | | (__| | | | _ | (__| |_) | |_) |
+// |____/ \___|_| |_|\___|_| |_|(_) \___| .__/| .__/ 
+//                                      | |   | |    
+//                                      |_|   |_|    
+//
+// Description:
+//
+//   Microbenchmarks for the hot paths of the renderer (see 'make bench')
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+//   Everything is generated here (a sphere on a ground plane, a procedural texture and a fixed rig of three spotlights) so the
+//   benchmarks don't need any external files, and the same work is done on every run. Each benchmark is run several times, and
+//   the best (shortest) time is reported, since anything else running on the machine can only ever make it slower.
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "texturebin.h"
+#include "render.h"
+#include "stats.h"
+#include "clip.h"
+#include "span.h"
+#include "tmap.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Constants
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	const	unsigned int	defaultRunCount = 5;
+static	const	unsigned int	renderWidth = 400;
+static	const	unsigned int	renderHeight = 300;
+static	const	unsigned int	benchTextureWidth = 256;
+static	const	unsigned int	benchTextureHeight = 256;
+static	const	unsigned int	bufferWidth = 1024;
+static	const	unsigned int	bufferHeight = 1024;
+static	const	unsigned int	sphereSegments = 48;
+static	const	unsigned int	sphereRings = 24;
+static	const	float		sphereRadius = 100;
+static	const	unsigned int	groundCells = 16;
+static	const	float		groundSize = 1600;
+static	const	unsigned int	lightSampleCount = 65536;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The synthetic scene that the benchmarks are run on
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	std::vector<primitive<> >	primitives;
+	std::vector<sLIGHT>		lights;
+	std::vector<ShadowMap>		shadowMaps;
+	Bvh				bvh;
+	std::vector<ShadowMap>		rayShadowMaps;	// The same lights, with ray traced shadows
+	sPHONG				phong;
+	Camera				camera;
+	Matrix4				xform;
+	std::vector<unsigned int>	texture;
+} sBENCHSCENE;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A single benchmark result. The polygon and pixel counts are the work done in a single run (zero if they don't apply.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	double		seconds;
+	double		polygons;
+	double		pixels;
+} sBENCHRESULT;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A simple (and most importantly, repeatable) random number generator
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	unsigned int	randomSeed = 1;
+
+static	float	random01()
+{
+	randomSeed = randomSeed * 1664525 + 1013904223;
+	return static_cast<float>(randomSeed >> 8) / static_cast<float>(1 << 24);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Adds the triangle (a, b, c) from a set of vertices. The winding is fixed up to match that of the 3DS importer, using the normals.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	void	addTriangle(std::vector<primitive<> > & primitives, const Point3 * pos, const Vector3 * normal, const Point2 * uv, const unsigned int a, const unsigned int b, const unsigned int c)
+{
+	const	unsigned int	index[3] = {a, b, c};
+	vert<>			v[3];
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		v[i].world() = Point4(pos[index[i]].x(), pos[index[i]].y(), pos[index[i]].z(), 1);
+		v[i].normal() = normal[index[i]];
+		v[i].texture() = uv[index[i]];
+	}
+
+	primitive<>	p;
+	p += v[0];
+	p += v[1];
+	p += v[2];
+	p.calcPlane(false);
+
+	if ((p.plane().normal() ^ (normal[a] + normal[b] + normal[c])) < 0)
+	{
+		p.vertices().clear();
+		p += v[0];
+		p += v[2];
+		p += v[1];
+		p.calcPlane(false);
+	}
+
+	primitives.push_back(p);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Builds the scene: a tessellated sphere sitting on a ground plane that extends well off-screen (so there's plenty to clip), lit by
+// three overlapping spotlights, each with its own shadow map.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	void	buildScene(sBENCHSCENE & scene)
+{
+	const	float	pi = 3.14159265359f;
+
+	// The sphere
+
+	for (unsigned int ring = 0; ring < sphereRings; ++ring)
+	{
+		for (unsigned int segment = 0; segment < sphereSegments; ++segment)
+		{
+			Point3	pos[4];
+			Vector3	normal[4];
+			Point2	uv[4];
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				unsigned int	r = ring + (i == 2 || i == 3 ? 1:0);
+				unsigned int	s = segment + (i == 1 || i == 2 ? 1:0);
+				float		theta = pi * static_cast<float>(r) / static_cast<float>(sphereRings);
+				float		phi = 2 * pi * static_cast<float>(s) / static_cast<float>(sphereSegments);
+
+				normal[i] = Vector3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+				pos[i] = normal[i] * sphereRadius;
+				uv[i] = Point2(static_cast<float>(s) / static_cast<float>(sphereSegments), static_cast<float>(r) / static_cast<float>(sphereRings));
+			}
+
+			// The quads at the poles have an edge of zero length, so they're just triangles
+
+			if (ring != 0)			addTriangle(scene.primitives, pos, normal, uv, 0, 1, 2);
+			if (ring != sphereRings - 1)	addTriangle(scene.primitives, pos, normal, uv, 0, 2, 3);
+		}
+	}
+
+	// The ground plane
+
+	float	cellSize = groundSize / static_cast<float>(groundCells);
+	for (unsigned int z = 0; z < groundCells; ++z)
+	{
+		for (unsigned int x = 0; x < groundCells; ++x)
+		{
+			float	x0 = -groundSize / 2 + cellSize * static_cast<float>(x);
+			float	z0 = -groundSize / 4 + cellSize * static_cast<float>(z);
+
+			Point3	pos[4] = {Point3(x0, -sphereRadius, z0), Point3(x0 + cellSize, -sphereRadius, z0), Point3(x0 + cellSize, -sphereRadius, z0 + cellSize), Point3(x0, -sphereRadius, z0 + cellSize)};
+			Vector3	normal[4] = {Vector3(0, 1, 0), Vector3(0, 1, 0), Vector3(0, 1, 0), Vector3(0, 1, 0)};
+			Point2	uv[4] = {Point2(0, 0), Point2(1, 0), Point2(1, 1), Point2(0, 1)};
+			addTriangle(scene.primitives, pos, normal, uv, 0, 1, 2);
+			addTriangle(scene.primitives, pos, normal, uv, 0, 2, 3);
+		}
+	}
+
+	// The light rig
+
+	const	Point3	lightPos[3] = {Point3(300, 400, -300), Point3(-400, 300, -200), Point3(0, 500, 300)};
+	const	Point3	lightColor[3] = {Point3(1.0f, 0.9f, 0.8f), Point3(0.4f, 0.5f, 0.8f), Point3(0.6f, 0.6f, 0.6f)};
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		sLIGHT	light;
+		light.pos = Point4(lightPos[i].x(), lightPos[i].y(), lightPos[i].z(), 1);
+		light.dir = -lightPos[i];
+		light.dir.normalize();
+		light.color = lightColor[i];
+		light.hotspot = cosf(pi / 180.0f * 20);
+		light.falloff = cosf(pi / 180.0f * 35);
+		light.innerRange = 400;
+		light.outerRange = 2000;
+		scene.lights.push_back(light);
+	}
+
+	// The same lighting defaults as texturebin
+
+	scene.phong.Ka = 0.1f;
+	scene.phong.Kd = 1;
+	scene.phong.Ks = 0.7f;
+	scene.phong.Sh = 10;
+	scene.phong.shadowMapBias = 2;
+	scene.phong.shadowMapRes = 1024;
+	scene.phong.shadowRays = false;
+	scene.phong.ambientColor = Point3(1, 1, 1);
+	scene.phong.specularColor = Point3(1, 1, 1);
+
+	ThreadPool	threads;
+	threads.start(1);
+	Render::renderShadowMaps(scene.shadowMaps, scene.primitives, std::vector<sMESH>(), NULL, scene.lights, scene.phong, threads);
+
+	// The BVH, and the shadow maps for tracing rays through it (just like Scene::load())
+
+	scene.bvh.build(scene.primitives);
+	for (unsigned int i = 0; i < scene.shadowMaps.size(); ++i)
+	{
+		ShadowMap	map;
+		map.camera = scene.shadowMaps[i].camera;
+		map.xform = scene.shadowMaps[i].xform;
+		map.bvh = &scene.bvh;
+		scene.rayShadowMaps.push_back(map);
+	}
+
+	// The camera
+
+	scene.camera.position = Point4(0, 150, -400, 1);
+	scene.camera.direction = Vector3(0, -150, 400);
+	scene.camera.direction.normalize();
+	scene.camera.bank = 0;
+	scene.camera.fov = pi / 180.0f * 60;
+	scene.camera.width = renderWidth;
+	scene.camera.height = renderHeight;
+	scene.camera.oversampleX = 1;
+	scene.camera.oversampleY = 1;
+	scene.xform = scene.camera.calcTransform();
+
+	// A procedural texture: a checkerboard with a color gradient
+
+	scene.texture.resize(benchTextureWidth * benchTextureHeight);
+	for (unsigned int y = 0; y < benchTextureHeight; ++y)
+	{
+		for (unsigned int x = 0; x < benchTextureWidth; ++x)
+		{
+			unsigned int	check = ((x >> 5) ^ (y >> 5)) & 1 ? 0xff : 0x80;
+			scene.texture[y * benchTextureWidth + x] = (check << 16) | ((x * check / benchTextureWidth) << 8) | (y * check / benchTextureHeight);
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The benchmarks
+//
+// Each one does its setup, then times the same work for each run and returns the best time.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchTexturedPolygons(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	frameCount = 10;
+
+	sBENCHRESULT	result = {0, 0, 0};
+	VertexArena			polygons;
+	Render::transformAndClip(polygons, scene.camera, scene.xform, benchTextureWidth, benchTextureHeight, scene.primitives, std::vector<sMESH>(), NULL);
+
+	std::vector<unsigned int>	frameBuffer(renderWidth * renderHeight);
+	std::vector<float>		zBuffer(renderWidth * renderHeight);
+	unsigned int *			texture = const_cast<unsigned int *>(&scene.texture[0]);
+
+	// Like the renderer, the span shader is set up once rather than for every polygon
+
+	sSPANSHADING	shading;
+	setupSpanShading(shading, scene.lights, scene.shadowMaps, scene.phong, texture, benchTextureWidth, benchTextureHeight);
+
+	sHIZ	hiz;
+	bool	useHiZ = hierarchicalZ();
+	if (useHiZ) createHiZ(hiz, &zBuffer[0], renderWidth, renderHeight);
+
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		sRASTERCOUNT	count = {0, 0};
+		double		start = Stats::wallTime();
+
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			memset(&frameBuffer[0], 0, frameBuffer.size() * sizeof(unsigned int));
+			memset(&zBuffer[0], 0, zBuffer.size() * sizeof(float));
+			if (useHiZ) clearHiZ(hiz, 0, renderHeight);
+
+			// Only the first frame of the first run is counted (counting isn't free)
+
+			sRASTERCOUNT *	counter = !run && !frame ? &count : NULL;
+			for (unsigned int i = 0; i < polygons.polygonCount(); ++i)
+			{
+				drawPerspectiveTexturedPolygon(polygons.vertices(i), polygons.vertexCount(i), scene.lights, scene.shadowMaps, scene.phong, &frameBuffer[0], texture, &zBuffer[0], renderWidth, benchTextureWidth, benchTextureHeight, 0, renderHeight, NULL, NULL, counter, NULL, &shading, useHiZ ? &hiz : NULL);
+			}
+		}
+
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+		if (!run) result.pixels = static_cast<double>(count.tested) * frameCount;
+	}
+
+	if (useHiZ) destroyHiZ(hiz);
+	result.polygons = static_cast<double>(polygons.polygonCount()) * frameCount;
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchShadowMapPolygons(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	mapCount = 10;
+
+	// Render from the first light, just like renderShadowMaps()
+
+	const	ShadowMap &	map = scene.shadowMaps[0];
+	VertexArena			polygons;
+	Render::transformAndClip(polygons, map.camera, map.xform, 1, 1, scene.primitives, std::vector<sMESH>(), NULL);
+
+	std::vector<float>	zBuffer(map.camera.width * map.camera.height);
+
+	sHIZ	hiz;
+	bool	useHiZ = hierarchicalZ();
+	if (useHiZ) createHiZ(hiz, &zBuffer[0], map.camera.width, map.camera.height);
+
+	sBENCHRESULT	result = {0, 0, 0};
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		sRASTERCOUNT	count = {0, 0};
+		double		start = Stats::wallTime();
+
+		for (unsigned int m = 0; m < mapCount; ++m)
+		{
+			memset(&zBuffer[0], 0, zBuffer.size() * sizeof(float));
+			if (useHiZ) clearHiZ(hiz, 0, map.camera.height);
+
+			sRASTERCOUNT *	counter = !run && !m ? &count : NULL;
+			for (unsigned int i = 0; i < polygons.polygonCount(); ++i)
+			{
+				drawShadowMapPolygon(polygons.vertices(i), polygons.vertexCount(i), &zBuffer[0], map.camera.width, 0, map.camera.height, counter, useHiZ ? &hiz : NULL);
+			}
+		}
+
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+		if (!run) result.pixels = static_cast<double>(count.tested) * mapCount;
+	}
+
+	if (useHiZ) destroyHiZ(hiz);
+	result.polygons = static_cast<double>(polygons.polygonCount()) * mapCount;
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchClipPolygon(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	passCount = 200;
+
+	// Find the polygons that transformAndClip() would clip: front facing and partially off-screen
+
+	std::vector<primitive<> >	clipList;
+	std::vector<unsigned int>	clipCodes;
+	for (unsigned int i = 0; i < scene.primitives.size(); ++i)
+	{
+		primitive<>	p = scene.primitives[i];
+		for (unsigned int j = 0; j < p.vertexCount(); ++j) p[j].xform(scene.xform);
+		p.calcViewPlane(false);
+
+		if (p[0].normalView().z() >= 0 && p[1].normalView().z() >= 0 && p[2].normalView().z() >= 0) continue;
+
+		unsigned int	codeOff = (unsigned int) -1;
+		unsigned int	codeOn = 0;
+		for (unsigned int j = 0; j < p.vertexCount(); ++j)
+		{
+			unsigned int	code = clipCode(p[j].worldView());
+			codeOff &= code;
+			codeOn  |= code;
+		}
+
+		if (!codeOff && codeOn)
+		{
+			clipList.push_back(p);
+			clipCodes.push_back(codeOn);
+		}
+	}
+
+	// Like transformAndClip(), this gathers the vertices of each polygon and clips them
+
+	sBENCHRESULT	result = {0, 0, 0};
+	unsigned int	survivors = 0;
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		double	start = Stats::wallTime();
+
+		for (unsigned int pass = 0; pass < passCount; ++pass)
+		{
+			for (unsigned int i = 0; i < clipList.size(); ++i)
+			{
+				const primitive<> &	p = clipList[i];
+				sCLIPVERT		clipVerts[maxClipVertices];
+				for (unsigned int j = 0; j < p.vertexCount(); ++j)
+				{
+					clipVerts[j].world = p[j].world();
+					clipVerts[j].view = p[j].worldView();
+					clipVerts[j].texture = p[j].textureView();
+					clipVerts[j].normal = p[j].normalView();
+				}
+
+				if (clipPolygon(clipVerts, p.vertexCount(), clipCodes[i]) >= 3) ++survivors;
+			}
+		}
+
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+	}
+
+	if (!survivors && clipList.size()) throw std::string("clipPolygon() rejected every polygon");
+	result.polygons = static_cast<double>(clipList.size()) * passCount;
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchLightSamples(const sBENCHSCENE & scene, const std::vector<ShadowMap> & shadowMaps, const unsigned int runCount)
+{
+	// Random points on the front-facing polygons, in the form that shade() passes them to light()
+
+	std::vector<primitive<> >	visible;
+	for (unsigned int i = 0; i < scene.primitives.size(); ++i)
+	{
+		primitive<>	p = scene.primitives[i];
+		for (unsigned int j = 0; j < p.vertexCount(); ++j) p[j].xform(scene.xform);
+		if (p[0].normalView().z() >= 0 && p[1].normalView().z() >= 0 && p[2].normalView().z() >= 0) continue;
+		visible.push_back(p);
+	}
+
+	std::vector<Vector3>	normals(lightSampleCount);
+	std::vector<Point4>	views(lightSampleCount);
+	std::vector<Point4>	worlds(lightSampleCount);
+	randomSeed = 1;
+	for (unsigned int i = 0; i < lightSampleCount; ++i)
+	{
+		const primitive<> &	p = visible[static_cast<unsigned int>(random01() * visible.size()) % visible.size()];
+		float	a = random01();
+		float	b = random01();
+		if (a + b > 1) {a = 1 - a; b = 1 - b;}
+		float	c = 1 - a - b;
+
+		normals[i] = p[0].normalView() * a + p[1].normalView() * b + p[2].normalView() * c;
+		normals[i].normalize();
+		views[i] = p[0].worldView() * a + p[1].worldView() * b + p[2].worldView() * c;
+		worlds[i] = p[0].world() * a + p[1].world() * b + p[2].world() * c;
+	}
+
+	sBENCHRESULT	result = {0, 0, 0};
+	Point3		diffuse(0.5f, 0.5f, 0.5f);
+	Point3		sum(0, 0, 0);
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		double	start = Stats::wallTime();
+
+		for (unsigned int i = 0; i < lightSampleCount; ++i)
+		{
+			sum += light(normals[i], views[i], worlds[i], diffuse, scene.lights, shadowMaps, scene.phong);
+		}
+
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+	}
+
+	if (sum.r() + sum.g() + sum.b() <= 0) throw std::string("light() didn't light anything");
+	result.pixels = lightSampleCount;
+	return result;
+}
+
+static	sBENCHRESULT	benchLight(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	return benchLightSamples(scene, scene.shadowMaps, runCount);
+}
+
+static	sBENCHRESULT	benchLightRays(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	return benchLightSamples(scene, scene.rayShadowMaps, runCount);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchConvert24To32(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	passCount = 4;
+	const	unsigned int	pixCount = bufferWidth * bufferHeight;
+
+	std::vector<unsigned char>	source(pixCount * 3);
+	std::vector<unsigned int>	dest(pixCount);
+	randomSeed = 1;
+	for (unsigned int i = 0; i < source.size(); ++i) source[i] = static_cast<unsigned char>(random01() * 256);
+
+	sBENCHRESULT	result = {0, 0, static_cast<double>(pixCount) * passCount};
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		double	start = Stats::wallTime();
+		for (unsigned int pass = 0; pass < passCount; ++pass) Render::convert24To32(&dest[0], &source[0], bufferWidth, bufferHeight);
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+	}
+
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchConvert32To24(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	passCount = 4;
+	const	unsigned int	pixCount = bufferWidth * bufferHeight;
+
+	std::vector<unsigned int>	source(pixCount);
+	std::vector<unsigned char>	dest(pixCount * 3);
+	randomSeed = 1;
+	for (unsigned int i = 0; i < pixCount; ++i) source[i] = static_cast<unsigned int>(random01() * 0x1000000);
+
+	sBENCHRESULT	result = {0, 0, static_cast<double>(pixCount) * passCount};
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		double	start = Stats::wallTime();
+		for (unsigned int pass = 0; pass < passCount; ++pass) Render::convert32To24(&dest[0], &source[0], bufferWidth, bufferHeight);
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+	}
+
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchAccumulateBuffer(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	passCount = 4;
+	const	unsigned int	pixCount = bufferWidth * bufferHeight;
+
+	std::vector<unsigned int>	frameBuffer(pixCount);
+	std::vector<unsigned int>	accumBuffer(pixCount * 3);
+	randomSeed = 1;
+	for (unsigned int i = 0; i < pixCount; ++i) frameBuffer[i] = static_cast<unsigned int>(random01() * 0x1000000);
+
+	sBENCHRESULT	result = {0, 0, static_cast<double>(pixCount) * passCount};
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		memset(&accumBuffer[0], 0, accumBuffer.size() * sizeof(unsigned int));
+
+		double	start = Stats::wallTime();
+		for (unsigned int pass = 0; pass < passCount; ++pass) Render::accumulateBuffer(&accumBuffer[0], &frameBuffer[0], bufferWidth, bufferHeight);
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+	}
+
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchDownsample(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	pixCount = bufferWidth * bufferHeight;
+
+	// An accumulation buffer of 4x4 oversample renders. Downsampling is done in place, so it's restored before each run.
+
+	std::vector<unsigned int>	source(pixCount * 3);
+	std::vector<unsigned int>	buffer(pixCount * 3);
+	randomSeed = 1;
+	for (unsigned int i = 0; i < source.size(); ++i) source[i] = static_cast<unsigned int>(random01() * 16 * 256);
+
+	sBENCHRESULT	result = {0, 0, static_cast<double>(pixCount)};
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		buffer = source;
+
+		double	start = Stats::wallTime();
+		Render::downsample(&buffer[0], bufferWidth, bufferHeight, 4, 4);
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+	}
+
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	sBENCHRESULT	benchDownsampleTo24(const sBENCHSCENE & scene, const unsigned int runCount)
+{
+	const	unsigned int	pixCount = bufferWidth * bufferHeight;
+
+	// The same accumulation buffer as benchDownsample() (this one leaves it alone)
+
+	std::vector<unsigned int>	source(pixCount * 3);
+	std::vector<unsigned char>	dest(pixCount * 3);
+	randomSeed = 1;
+	for (unsigned int i = 0; i < source.size(); ++i) source[i] = static_cast<unsigned int>(random01() * 16 * 256);
+
+	sBENCHRESULT	result = {0, 0, static_cast<double>(pixCount)};
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		double	start = Stats::wallTime();
+		Render::downsampleTo24(&dest[0], &source[0], bufferWidth, bufferHeight, 4, 4);
+		double	seconds = Stats::wallTime() - start;
+		if (!run || seconds < result.seconds) result.seconds = seconds;
+	}
+
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The benchmark table. Benchmarks that depend on the span shader (see Span.h) are run once for each one, with the shader (and the
+// matching pixel routines) given here selected for the run (SPAN_SHADER_COUNT just leaves the defaults selected.) The rasterizer and
+// the hierarchical z-buffer (see TMap.h) are selected the same way, so they can be compared side by side. The pixel counts are the
+// pixels that were depth tested, so they drop when the hierarchical z-buffer skips hidden spans -- compare the times per polygon.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	sBENCHRESULT	(*BenchFunction)(const sBENCHSCENE & scene, const unsigned int runCount);
+
+typedef	struct
+{
+	const	char *		name;
+	BenchFunction		function;
+	SpanShader		shader;
+	Rasterizer		raster;
+	bool			hiz;
+} sBENCHMARK;
+
+static	const	sBENCHMARK	benchmarks[] =
+{
+	{"drawPerspectiveTexturedPolygon [scalar]",		benchTexturedPolygons,	SPAN_SCALAR,		RASTER_SCANLINE,	false},
+	{"drawPerspectiveTexturedPolygon [sse2]",		benchTexturedPolygons,	SPAN_SSE2,		RASTER_SCANLINE,	false},
+	{"drawPerspectiveTexturedPolygon [avx2]",		benchTexturedPolygons,	SPAN_AVX2,		RASTER_SCANLINE,	false},
+	{"drawPerspectiveTexturedPolygon [scalar, halfspace]",	benchTexturedPolygons,	SPAN_SCALAR,		RASTER_HALFSPACE,	false},
+	{"drawPerspectiveTexturedPolygon [sse2, halfspace]",	benchTexturedPolygons,	SPAN_SSE2,		RASTER_HALFSPACE,	false},
+	{"drawPerspectiveTexturedPolygon [avx2, halfspace]",	benchTexturedPolygons,	SPAN_AVX2,		RASTER_HALFSPACE,	false},
+	{"drawPerspectiveTexturedPolygon [scalar, hiz]",	benchTexturedPolygons,	SPAN_SCALAR,		RASTER_SCANLINE,	true},
+	{"drawPerspectiveTexturedPolygon [avx2, hiz]",		benchTexturedPolygons,	SPAN_AVX2,		RASTER_SCANLINE,	true},
+	{"drawShadowMapPolygon",				benchShadowMapPolygons,	SPAN_SHADER_COUNT,	RASTER_SCANLINE,	false},
+	{"drawShadowMapPolygon [halfspace]",			benchShadowMapPolygons,	SPAN_SHADER_COUNT,	RASTER_HALFSPACE,	false},
+	{"drawShadowMapPolygon [hiz]",				benchShadowMapPolygons,	SPAN_SHADER_COUNT,	RASTER_SCANLINE,	true},
+	{"drawShadowMapPolygon [halfspace, hiz]",		benchShadowMapPolygons,	SPAN_SHADER_COUNT,	RASTER_HALFSPACE,	true},
+	{"clipPolygon",						benchClipPolygon,	SPAN_SHADER_COUNT,	RASTER_SCANLINE,	false},
+	{"light",						benchLight,		SPAN_SHADER_COUNT,	RASTER_SCANLINE,	false},
+	{"light [rays]",					benchLightRays,		SPAN_SHADER_COUNT,	RASTER_SCANLINE,	false},
+	{"convert24To32 [scalar]",				benchConvert24To32,	SPAN_SCALAR,		RASTER_SCANLINE,	false},
+	{"convert24To32 [sse2]",				benchConvert24To32,	SPAN_SSE2,		RASTER_SCANLINE,	false},
+	{"convert24To32 [avx2]",				benchConvert24To32,	SPAN_AVX2,		RASTER_SCANLINE,	false},
+	{"convert32To24 [scalar]",				benchConvert32To24,	SPAN_SCALAR,		RASTER_SCANLINE,	false},
+	{"convert32To24 [sse2]",				benchConvert32To24,	SPAN_SSE2,		RASTER_SCANLINE,	false},
+	{"convert32To24 [avx2]",				benchConvert32To24,	SPAN_AVX2,		RASTER_SCANLINE,	false},
+	{"accumulateBuffer [scalar]",				benchAccumulateBuffer,	SPAN_SCALAR,		RASTER_SCANLINE,	false},
+	{"accumulateBuffer [sse2]",				benchAccumulateBuffer,	SPAN_SSE2,		RASTER_SCANLINE,	false},
+	{"accumulateBuffer [avx2]",				benchAccumulateBuffer,	SPAN_AVX2,		RASTER_SCANLINE,	false},
+	{"downsample [scalar]",					benchDownsample,	SPAN_SCALAR,		RASTER_SCANLINE,	false},
+	{"downsample [sse2]",					benchDownsample,	SPAN_SSE2,		RASTER_SCANLINE,	false},
+	{"downsample [avx2]",					benchDownsample,	SPAN_AVX2,		RASTER_SCANLINE,	false},
+	{"downsampleTo24 [scalar]",				benchDownsampleTo24,	SPAN_SCALAR,		RASTER_SCANLINE,	false},
+	{"downsampleTo24 [sse2]",				benchDownsampleTo24,	SPAN_SSE2,		RASTER_SCANLINE,	false},
+	{"downsampleTo24 [avx2]",				benchDownsampleTo24,	SPAN_AVX2,		RASTER_SCANLINE,	false},
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	void	printUsage()
+{
+	fprintf(stderr, "Usage: texturebench [options] [benchmark [...]]\n");
+	fprintf(stderr, "       -h    this help\n");
+	fprintf(stderr, "       -rNNN run each benchmark NNN times, and report the best (default = %d)\n", defaultRunCount);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   With no benchmarks given, they're all run. Otherwise, only the ones\n");
+	fprintf(stderr, "   whose names contain one of the given strings are run. The benchmarks are:\n");
+	fprintf(stderr, "\n");
+	for (unsigned int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i) fprintf(stderr, "       %s\n", benchmarks[i].name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The program will return '0' on error, and '1' on success.\n");
+
+	// Cause an error-free immediate exit from the program
+
+	throw std::string("");
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+int	main(const int argc, const char * argv[])
+{
+	unsigned int			runCount = defaultRunCount;
+	std::vector<std::string>	names;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (argv[i][0] == '-')
+			{
+				switch(tolower(argv[i][1]))
+				{
+					case 'h':
+						printUsage();
+						break;
+
+					case 'r':
+						runCount = atoi(&argv[i][2]);
+						if (runCount < 1) runCount = 1;
+						break;
+
+					default:
+						fprintf(stderr, "Unknown command line option: %s\n\n", argv[i]);
+						printUsage();
+						break;
+				}
+			}
+			else
+			{
+				names.push_back(std::string(argv[i]));
+			}
+		}
+
+		printf("Building the scene...");
+		sBENCHSCENE	scene;
+		buildScene(scene);
+		printf("%d polygons, %d lights, %dx%d render, %dx%d buffers, best of %d runs\n\n", static_cast<unsigned int>(scene.primitives.size()), static_cast<unsigned int>(scene.lights.size()), renderWidth, renderHeight, bufferWidth, bufferHeight, runCount);
+
+		printf("%-52s %12s %12s %12s %12s\n", "benchmark", "polygons", "pixels", "ns/polygon", "ns/pixel");
+		for (unsigned int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i)
+		{
+			bool	selected = !names.size();
+			for (unsigned int j = 0; j < names.size() && !selected; ++j)
+			{
+				if (strstr(benchmarks[i].name, names[j].c_str())) selected = true;
+			}
+			if (!selected) continue;
+
+			// Shaders this build/processor doesn't support are simply reported without any results
+
+			sBENCHRESULT	result = {0, 0, 0};
+			SpanShader	shader = benchmarks[i].shader;
+			Rasterizer	previousRasterizer = rasterizer();
+			bool		previousHiZ = hierarchicalZ();
+			setRasterizer(benchmarks[i].raster);
+			setHierarchicalZ(benchmarks[i].hiz);
+			if (shader == SPAN_SHADER_COUNT)
+			{
+				result = benchmarks[i].function(scene, runCount);
+			}
+			else if (spanShaderSupported(shader))
+			{
+				SpanShader	previousShader = spanShader();
+				SpanShader	previousPixelRoutines = pixelRoutines();
+				setSpanShader(shader);
+				setPixelRoutines(shader);
+				result = benchmarks[i].function(scene, runCount);
+				setSpanShader(previousShader);
+				setPixelRoutines(previousPixelRoutines);
+			}
+			setRasterizer(previousRasterizer);
+			setHierarchicalZ(previousHiZ);
+
+			char	polygons[32] = "-", pixels[32] = "-", nsPerPolygon[32] = "-", nsPerPixel[32] = "-";
+			if (result.polygons)
+			{
+				sprintf(polygons, "%.0f", result.polygons);
+				sprintf(nsPerPolygon, "%.1f", result.seconds * 1e9 / result.polygons);
+			}
+			if (result.pixels)
+			{
+				sprintf(pixels, "%.0f", result.pixels);
+				sprintf(nsPerPixel, "%.2f", result.seconds * 1e9 / result.pixels);
+			}
+			printf("%-52s %12s %12s %12s %12s\n", benchmarks[i].name, polygons, pixels, nsPerPolygon, nsPerPixel);
+		}
+
+		// Done with these
+
+		for (unsigned int i = 0; i < scene.shadowMaps.size(); ++i) delete[] scene.shadowMaps[i].zBuffer;
+	}
+	catch(const std::string & err)
+	{
+		if (err.length()) fprintf(stderr, "\nError: %s\n", err.c_str());
+		return 0;
+	}
+
+	return 1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Bench.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,403 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____        _                        
+// |  _ \      | |                       
+// | |_) |_   _| |__     ___ _ __  _ __  
+// |  _ <\ \ / / '_ \   / __| '_ \| '_ \ 
+// | |_) |\ V /| | | |_| (__| |_) | |_) |
+// |____/  \_/ |_| |_(_)\___| .__/| .__/ 
+//                          | |   | |    
+//                          |_|   |_|    
+//
+// Description:
+//
+//   Bounding volume hierarchy over the scene's primitives, for culling and shadow rays
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "texturebin.h"
+#include "bvh.h"
+#include "clip.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Constants
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Nodes with this many primitives (or fewer) aren't split any further
+
+static	const	unsigned int	leafPrimitives = 4;
+
+// The median split halves every node, so this is deeper than any tree of (up to) 2^32 primitives can get
+
+static	const	unsigned int	maxDepth = 64;
+
+// Bounds are grown by this fraction of their size (plus this much) before they're tested, so that the rounding in transforming a
+// box can't cull a vertex that transforms to just inside the view volume
+
+static	const	float		boundsMargin = 1.0f / 1024.0f;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Orders primitive indices by one axis of their centers (for the median split)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	CenterLess
+{
+public:
+			CenterLess(const std::vector<Point3> & centers, const unsigned int axis) : _centers(centers), _axis(axis) {}
+
+inline		bool	operator()(const unsigned int a, const unsigned int b) const
+			{
+				return _centers[a].data()[_axis] < _centers[b].data()[_axis];
+			}
+
+private:
+	const	std::vector<Point3> &	_centers;
+		unsigned int		_axis;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	Bvh::Bvh()
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	Bvh::~Bvh()
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Bvh::build(const std::vector<primitive<> > & primitives)
+{
+	clear();
+	if (primitives.empty()) return;
+
+	// The center of each primitive (what it's sorted by)
+
+	std::vector<Point3>	centers(primitives.size());
+	_primitives.resize(primitives.size());
+	for (unsigned int i = 0; i < primitives.size(); ++i)
+	{
+		const primitive<> &	p = primitives[i];
+		if (p.vertexCount() != 3) throw std::string("BVH primitives must be triangles");
+
+		Point3	center(0, 0, 0);
+		for (unsigned int j = 0; j < 3; ++j) center += Point3(p[j].world().x(), p[j].world().y(), p[j].world().z());
+		centers[i] = center / 3.0f;
+		_primitives[i] = i;
+	}
+
+	// A median split makes (at most) two nodes for every leaf
+
+	_nodes.reserve(primitives.size() / leafPrimitives * 2 + 1);
+	buildNode(primitives, centers, 0, static_cast<unsigned int>(primitives.size()));
+
+	// The triangles for the rays, in leaf order. They're wound so that the cross product of the edges points out of the front
+	// (the side the vertex normals face.)
+
+	_triangles.resize(_primitives.size() * 9);
+	float *	t = &_triangles[0];
+	for (unsigned int i = 0; i < _primitives.size(); ++i, t += 9)
+	{
+		const primitive<> &	p = primitives[_primitives[i]];
+		Vector3			normal = p[0].normal() + p[1].normal() + p[2].normal();
+		Vector3			edge1(p[1].world() - p[0].world());
+		Vector3			edge2(p[2].world() - p[0].world());
+		bool			flip = ((edge1 % edge2) ^ normal) < 0;
+		const Point4 &		v0 = p[0].world();
+		const Point4 &		v1 = p[flip ? 2:1].world();
+		const Point4 &		v2 = p[flip ? 1:2].world();
+		t[0] = v0.x();		t[1] = v0.y();		t[2] = v0.z();
+		t[3] = v1.x() - v0.x();	t[4] = v1.y() - v0.y();	t[5] = v1.z() - v0.z();
+		t[6] = v2.x() - v0.x();	t[7] = v2.y() - v0.y();	t[8] = v2.z() - v0.z();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+unsigned int	Bvh::buildNode(const std::vector<primitive<> > & primitives, std::vector<Point3> & centers, const unsigned int first, const unsigned int count)
+{
+	unsigned int	index = static_cast<unsigned int>(_nodes.size());
+	_nodes.resize(index + 1);
+
+	// The bounds of the primitives, and of their centers
+
+	Point3	minimum, maximum, centerMin, centerMax;
+	for (unsigned int i = first; i < first + count; ++i)
+	{
+		const primitive<> &	p = primitives[_primitives[i]];
+		const Point3 &		c = centers[_primitives[i]];
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			const Point4 &	v = p[j].world();
+			bool		start = i == first && j == 0;
+			if (start || v.x() < minimum.x()) minimum.x() = v.x();
+			if (start || v.y() < minimum.y()) minimum.y() = v.y();
+			if (start || v.z() < minimum.z()) minimum.z() = v.z();
+			if (start || v.x() > maximum.x()) maximum.x() = v.x();
+			if (start || v.y() > maximum.y()) maximum.y() = v.y();
+			if (start || v.z() > maximum.z()) maximum.z() = v.z();
+		}
+		if (i == first) centerMin = centerMax = c;
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			if (c.data()[j] < centerMin.data()[j]) centerMin.data()[j] = c.data()[j];
+			if (c.data()[j] > centerMax.data()[j]) centerMax.data()[j] = c.data()[j];
+		}
+	}
+
+	_nodes[index].minimum = minimum;
+	_nodes[index].maximum = maximum;
+	_nodes[index].first = first;
+	_nodes[index].count = count;
+	_nodes[index].second = 0;
+
+	// A leaf keeps its primitives in their original order
+
+	if (count <= leafPrimitives)
+	{
+		std::sort(_primitives.begin() + first, _primitives.begin() + first + count);
+		return index;
+	}
+
+	// Split in half across the longest axis of the centers
+
+	Point3		extent = centerMax - centerMin;
+	unsigned int	axis = 0;
+	if (extent.y() > extent.data()[axis]) axis = 1;
+	if (extent.z() > extent.data()[axis]) axis = 2;
+
+	unsigned int	half = count / 2;
+	std::nth_element(_primitives.begin() + first, _primitives.begin() + first + half, _primitives.begin() + first + count, CenterLess(centers, axis));
+
+	buildNode(primitives, centers, first, half);
+	unsigned int	second = buildNode(primitives, centers, first + half, count - half);
+	_nodes[index].second = second;
+	return index;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Bvh::clear()
+{
+	_nodes.clear();
+	_primitives.clear();
+	_triangles.clear();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Bvh::cull(std::vector<unsigned int> & order, const Matrix4 & xform, const Point3 & eye, const Vector3 & direction, const float range, sCULLCOUNT & count) const
+{
+	if (empty()) return;
+
+	// Each node on the stack carries whether its parent was entirely inside the view volume (so it is too, and needn't be
+	// tested against it.) The range is always tested, since it doesn't get any cheaper.
+
+	unsigned int	stack[maxDepth * 2];
+	bool		insideStack[maxDepth * 2];
+	unsigned int	depth = 0;
+	stack[depth] = 0;
+	insideStack[depth++] = false;
+
+	while (depth)
+	{
+		--depth;
+		const sNODE &	node = _nodes[stack[depth]];
+		bool		inside = insideStack[depth];
+
+		if (!inside || range > 0)
+		{
+			++count.tested;
+			if ((!inside && boundsOutside(node.minimum, node.maximum, xform, inside)) || (range > 0 && boundsBeyond(node.minimum, node.maximum, eye, range)))
+			{
+				++count.culled;
+				count.polygons += node.count;
+				continue;
+			}
+		}
+
+		if (!node.second)
+		{
+			order.insert(order.end(), _primitives.begin() + node.first, _primitives.begin() + node.first + node.count);
+			continue;
+		}
+
+		// Push the farther child first, so the nearer one comes off the stack first
+
+		unsigned int	nearChild = stack[depth] + 1;
+		unsigned int	farChild = node.second;
+		const sNODE &	a = _nodes[nearChild];
+		const sNODE &	b = _nodes[farChild];
+		Vector3		toA((a.minimum + a.maximum) * 0.5f - eye);
+		Vector3		toB((b.minimum + b.maximum) * 0.5f - eye);
+		if ((toB ^ direction) < (toA ^ direction)) std::swap(nearChild, farChild);
+
+		stack[depth] = farChild;
+		insideStack[depth++] = inside;
+		stack[depth] = nearChild;
+		insideStack[depth++] = inside;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	Bvh::occluded(const Point3 & from, const Point3 & to, const float bias) const
+{
+	if (empty()) return false;
+
+	// The segment is from + d * t, for t in (tMin, 1). The slab test needs the reciprocal of every component of d, so a zero
+	// component is nudged to a tiny one (we may be built without IEEE infinities.)
+
+	float	o[3] = {from.x(), from.y(), from.z()};
+	float	d[3] = {to.x() - from.x(), to.y() - from.y(), to.z() - from.z()};
+	float	length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	if (length <= bias) return false;
+
+	float	tMin = bias / length;
+	float	invD[3];
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		if (fabsf(d[i]) < 1e-20f) d[i] = d[i] < 0 ? -1e-20f : 1e-20f;
+		invD[i] = 1.0f / d[i];
+	}
+
+	unsigned int	stack[maxDepth * 2];
+	unsigned int	depth = 0;
+	stack[depth++] = 0;
+
+	while (depth)
+	{
+		unsigned int	index = stack[--depth];
+		const sNODE &	node = _nodes[index];
+
+		// Slab test (with a little slack, so rounding can't miss a triangle that lies on a face of the box)
+
+		float	tNear = tMin, tFar = 1;
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			float	t0 = (node.minimum.data()[i] - o[i]) * invD[i];
+			float	t1 = (node.maximum.data()[i] - o[i]) * invD[i];
+			if (t0 > t1) std::swap(t0, t1);
+			if (t0 > tNear) tNear = t0;
+			if (t1 < tFar) tFar = t1;
+		}
+		if (tNear > tFar * 1.0001f + 1e-6f) continue;
+
+		if (node.second)
+		{
+			stack[depth++] = node.second;
+			stack[depth++] = index + 1;
+			continue;
+		}
+
+		// Moller-Trumbore, for any hit along the segment. Like the shadow maps (which are back-face culled), only the triangles
+		// that face the end of the segment block it.
+
+		const float *	t = &_triangles[node.first * 9];
+		for (unsigned int i = 0; i < node.count; ++i, t += 9)
+		{
+			const float *	e1 = t + 3;
+			const float *	e2 = t + 6;
+			float	p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+			float	det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+			if (det >= 0) continue;
+			float	invDet = 1.0f / det;
+
+			float	s[3] = {o[0] - t[0], o[1] - t[1], o[2] - t[2]};
+			float	u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+			if (u < 0 || u > 1) continue;
+
+			float	q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+			float	v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+			if (v < 0 || u + v > 1) continue;
+
+			float	hit = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+			if (hit > tMin && hit < 1) return true;
+		}
+	}
+
+	return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A box is entirely outside the view volume if every corner is outside the same clip plane, and entirely inside it if no corner is
+// outside any of them. The box is grown by a hair first (see boundsMargin.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	boundsOutside(const Point3 & minimum, const Point3 & maximum, const Matrix4 & xform, bool & inside)
+{
+	Point3		extent = maximum - minimum;
+	float		margin = sqrtf(extent ^ extent) * 0.5f * boundsMargin + boundsMargin;
+	Point3		grownMin = minimum - Point3(margin, margin, margin);
+	Point3		grownMax = maximum + Point3(margin, margin, margin);
+
+	unsigned int	codeOff = (unsigned int) -1;
+	unsigned int	codeOn = 0;
+	for (unsigned int i = 0; i < 8; ++i)
+	{
+		Point4		corner(i & 1 ? grownMax.x() : grownMin.x(), i & 2 ? grownMax.y() : grownMin.y(), i & 4 ? grownMax.z() : grownMin.z(), 1);
+		unsigned int	code = clipCode(xform >> corner);
+		codeOff &= code;
+		codeOn |= code;
+	}
+
+	inside = codeOn == 0;
+	return codeOff != 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	boundsBeyond(const Point3 & minimum, const Point3 & maximum, const Point3 & eye, const float range)
+{
+	// The distance to the nearest point of the box (with the same margin for rounding as boundsOutside)
+
+	float	dist2 = 0;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		float	e = eye.data()[i];
+		float	d = 0;
+		if (e < minimum.data()[i]) d = minimum.data()[i] - e;
+		else if (e > maximum.data()[i]) d = e - maximum.data()[i];
+		dist2 += d * d;
+	}
+
+	float	reach = range + range * boundsMargin + boundsMargin;
+	return dist2 > reach * reach;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Whether the renderer culls with the BVH (see Bvh.h)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	bool	bvhCullingEnabled = true;
+
+void	setBvhCulling(const bool enabled)
+{
+	bvhCullingEnabled = enabled;
+}
+
+bool	bvhCulling()
+{
+	return bvhCullingEnabled;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Bvh.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,136 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____        _        _     
+// |  _ \      | |      | |    
+// | |_) |_   _| |__    | |__  
+// |  _ <\ \ / / '_ \   | '_ \ 
+// | |_) |\ V /| | | |_ | | | |
+// |____/  \_/ |_| |_(_)|_| |_|
+//                             
+//                             
+//
+// Description:
+//
+//   Bounding volume hierarchy over the scene's primitives, for culling and shadow rays
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_BVH
+#define _H_BVH
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Module setup (required includes, macros, etc.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "primitive.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// What culling did: the bounds (meshes or BVH nodes) that were tested, how many of them were culled and the polygons that were
+// culled along with them
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	unsigned int	tested;
+	unsigned int	culled;
+	unsigned int	polygons;
+} sCULLCOUNT;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A bounding volume hierarchy (of axis-aligned boxes) over a set of primitives, which must be triangles. It's built once for the
+// scene (it only depends on the world positions) and never changes after that, so any number of threads can query it at once.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	Bvh
+{
+public:
+	// Construction/Destruction
+
+					Bvh();
+virtual					~Bvh();
+
+	// Implementation
+
+	// Builds the hierarchy, replacing any previous one. Each node is split in half (by primitive count) across the longest
+	// axis of its primitives' centers, down to a handful of primitives per leaf.
+
+virtual		void			build(const std::vector<primitive<> > & primitives);
+
+virtual		void			clear();
+
+	// Appends the primitives that aren't culled to 'order', nearest first. A node is culled if its box is entirely outside
+	// the view volume of 'xform' or (if range is non-zero) entirely farther than range from 'eye'. The children of each node
+	// are visited in order of the depth of their centers along 'direction', so the leaves come out roughly front-to-back.
+	// The primitives within a leaf keep their original order.
+
+virtual		void			cull(std::vector<unsigned int> & order, const Matrix4 & xform, const Point3 & eye, const Vector3 & direction, const float range, sCULLCOUNT & count) const;
+
+	// Returns true if any primitive that faces 'to' crosses the line segment from 'from' to 'to', ignoring anything within
+	// 'bias' of 'from' (the surface that the segment starts on.)
+
+virtual		bool			occluded(const Point3 & from, const Point3 & to, const float bias) const;
+
+	// Accessors
+
+inline	const	unsigned int		nodeCount() const	{return static_cast<unsigned int>(_nodes.size());}
+inline	const	bool			empty() const		{return _nodes.empty();}
+
+private:
+	// A node covers a contiguous range of the primitive list. Its first child (if it isn't a leaf) is the next node.
+
+	typedef	struct
+	{
+		Point3		minimum;
+		Point3		maximum;
+		unsigned int	first;		// Range of _primitives
+		unsigned int	count;
+		unsigned int	second;		// Second child (0 for a leaf -- the root is never anybody's child)
+	} sNODE;
+
+		unsigned int		buildNode(const std::vector<primitive<> > & primitives, std::vector<Point3> & centers, const unsigned int first, const unsigned int count);
+
+	// Data members
+
+		std::vector<sNODE>	_nodes;
+		std::vector<unsigned int>	_primitives;	// Primitive indices, in leaf order
+		std::vector<float>	_triangles;	// For the rays: the first vertex and the two edges from it (9 floats) for each
+							// entry of _primitives
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Bounds tests, shared by the BVH and the per-mesh culling (see Render::cullPrimitives())
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Returns true if a box is entirely outside the view volume of 'xform'. If it isn't, 'inside' is set if it's entirely inside.
+
+bool	boundsOutside(const Point3 & minimum, const Point3 & maximum, const Matrix4 & xform, bool & inside);
+
+// Returns true if every point of a box is farther than 'range' from 'eye'
+
+bool	boundsBeyond(const Point3 & minimum, const Point3 & maximum, const Point3 & eye, const float range);
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Whether the renderer culls with the scene's BVH (the default) or just with the bounds of each mesh
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	setBvhCulling(const bool enabled);
+bool	bvhCulling();
+
+#endif // _H_BVH
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Bvh.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
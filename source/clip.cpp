@@ -106,196 +106,102 @@ static	inline	void	bClip(Point4 &wdst, const Point4 &won, const Point4 &woff, Po
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
-
-static	unsigned int	neClip(primitive<> &src)
-{
-	primitive<>	dst;
-	vert<>		tmp;
-
-	for (unsigned int i = 0; i < src.vertexCount(); i++)
-	{
-		Point4		&wcur = src[i].world();
-		Point4		&vcur = src[i].worldView();
-		Point2		&tcur = src[i].textureView();
-		Point3		&ncur = src[i].normalView();
-		Point4		&wnex = (i == src.vertexCount()-1) ? src[0].world():src[i+1].world();
-		Point4		&vnex = (i == src.vertexCount()-1) ? src[0].worldView():src[i+1].worldView();
-		Point2		&tnex = (i == src.vertexCount()-1) ? src[0].textureView():src[i+1].textureView();
-		Point3		&nnex = (i == src.vertexCount()-1) ? src[0].normalView():src[i+1].normalView();
-
-		switch((vcur.z() < 0.0 ? 1:0)|(vnex.z() < 0.0 ? 2:0))
-		{
-			case 0:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp; break;
-			case 1: nClip(tmp.world(), wnex, wcur, tmp.worldView(), vnex, vcur, tmp.textureView(), tnex, tcur, tmp.normalView(), nnex, ncur); dst += tmp; break;
-			case 2:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp;
-				nClip(tmp.world(), wcur, wnex, tmp.worldView(), vcur, vnex, tmp.textureView(), tcur, tnex, tmp.normalView(), ncur, nnex); dst += tmp; break;
-		}
-	}
-	src = dst;
-	return src.vertexCount();
-}
-
+// Per-plane tests & intersections. The plane is a template parameter (its outcode bit) so these all fold away at compile time.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-static	unsigned int	feClip(primitive<> &src)
+template <unsigned int plane>
+static	inline	bool	outside(const Point4 &v)
 {
-	primitive<>	dst;
-	vert<>		tmp;
-
-	for (unsigned int i = 0; i < src.vertexCount(); i++)
+	switch(plane)
 	{
-		Point4		&wcur = src[i].world();
-		Point4		&vcur = src[i].worldView();
-		Point2		&tcur = src[i].textureView();
-		Point3		&ncur = src[i].normalView();
-		Point4		&wnex = (i == src.vertexCount()-1) ? src[0].world():src[i+1].world();
-		Point4		&vnex = (i == src.vertexCount()-1) ? src[0].worldView():src[i+1].worldView();
-		Point2		&tnex = (i == src.vertexCount()-1) ? src[0].textureView():src[i+1].textureView();
-		Point3		&nnex = (i == src.vertexCount()-1) ? src[0].normalView():src[i+1].normalView();
-
-		switch((vcur.z() > vcur.w() ? 1:0)|(vnex.z() > vnex.w() ? 2:0))
-		{
-			case 0:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp; break;
-			case 1: fClip(tmp.world(), wnex, wcur, tmp.worldView(), vnex, vcur, tmp.textureView(), tnex, tcur, tmp.normalView(), nnex, ncur); dst += tmp; break;
-			case 2:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp;
-				fClip(tmp.world(), wcur, wnex, tmp.worldView(), vcur, vnex, tmp.textureView(), tcur, tnex, tmp.normalView(), ncur, nnex); dst += tmp; break;
-		}
+		case CLIP_NEAR:		return v.z() < 0.0;
+		case CLIP_FAR:		return v.z() > v.w();
+		case CLIP_LEFT:		return v.x() < -v.w();
+		case CLIP_RIGHT:	return v.x() > v.w();
+		case CLIP_TOP:		return v.y() > v.w();
+		default:		return v.y() < -v.w();
 	}
-	src = dst;
-	return src.vertexCount();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-static	unsigned int	leClip(primitive<> &src)
+template <unsigned int plane>
+static	inline	void	intersect(sCLIPVERT &dst, const sCLIPVERT &on, const sCLIPVERT &off)
 {
-	primitive<>	dst;
-	vert<>		tmp;
-
-	for (unsigned int i = 0; i < src.vertexCount(); i++)
+	switch(plane)
 	{
-		Point4		&wcur = src[i].world();
-		Point4		&vcur = src[i].worldView();
-		Point2		&tcur = src[i].textureView();
-		Point3		&ncur = src[i].normalView();
-		Point4		&wnex = (i == src.vertexCount()-1) ? src[0].world():src[i+1].world();
-		Point4		&vnex = (i == src.vertexCount()-1) ? src[0].worldView():src[i+1].worldView();
-		Point2		&tnex = (i == src.vertexCount()-1) ? src[0].textureView():src[i+1].textureView();
-		Point3		&nnex = (i == src.vertexCount()-1) ? src[0].normalView():src[i+1].normalView();
-
-		switch((vcur.x() < -vcur.w() ? 1:0)|(vnex.x() < -vnex.w() ? 2:0))
-		{
-			case 0:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp; break;
-			case 1: lClip(tmp.world(), wnex, wcur, tmp.worldView(), vnex, vcur, tmp.textureView(), tnex, tcur, tmp.normalView(), nnex, ncur); dst += tmp; break;
-			case 2:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp;
-				lClip(tmp.world(), wcur, wnex, tmp.worldView(), vcur, vnex, tmp.textureView(), tcur, tnex, tmp.normalView(), ncur, nnex); dst += tmp; break;
-		}
+		case CLIP_NEAR:		nClip(dst.world, on.world, off.world, dst.view, on.view, off.view, dst.texture, on.texture, off.texture, dst.normal, on.normal, off.normal); break;
+		case CLIP_FAR:		fClip(dst.world, on.world, off.world, dst.view, on.view, off.view, dst.texture, on.texture, off.texture, dst.normal, on.normal, off.normal); break;
+		case CLIP_LEFT:		lClip(dst.world, on.world, off.world, dst.view, on.view, off.view, dst.texture, on.texture, off.texture, dst.normal, on.normal, off.normal); break;
+		case CLIP_RIGHT:	rClip(dst.world, on.world, off.world, dst.view, on.view, off.view, dst.texture, on.texture, off.texture, dst.normal, on.normal, off.normal); break;
+		case CLIP_TOP:		tClip(dst.world, on.world, off.world, dst.view, on.view, off.view, dst.texture, on.texture, off.texture, dst.normal, on.normal, off.normal); break;
+		default:		bClip(dst.world, on.world, off.world, dst.view, on.view, off.view, dst.texture, on.texture, off.texture, dst.normal, on.normal, off.normal); break;
 	}
-	src = dst;
-	return src.vertexCount();
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Clips the polygon in 'src' against a single plane into 'dst', then swaps the two (so 'src' always holds the current polygon.)
+// Returns false if the polygon is gone.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-static	unsigned int	reClip(primitive<> &src)
+template <unsigned int plane>
+static	inline	bool	clipPlane(sCLIPVERT *&src, sCLIPVERT *&dst, unsigned int &count)
 {
-	primitive<>	dst;
-	vert<>		tmp;
+	unsigned int	dstCount = 0;
+	bool		curOut = outside<plane>(src[0].view);
 
-	for (unsigned int i = 0; i < src.vertexCount(); i++)
+	for (unsigned int i = 0; i < count; i++)
 	{
-		Point4		&wcur = src[i].world();
-		Point4		&vcur = src[i].worldView();
-		Point2		&tcur = src[i].textureView();
-		Point3		&ncur = src[i].normalView();
-		Point4		&wnex = (i == src.vertexCount()-1) ? src[0].world():src[i+1].world();
-		Point4		&vnex = (i == src.vertexCount()-1) ? src[0].worldView():src[i+1].worldView();
-		Point2		&tnex = (i == src.vertexCount()-1) ? src[0].textureView():src[i+1].textureView();
-		Point3		&nnex = (i == src.vertexCount()-1) ? src[0].normalView():src[i+1].normalView();
-
-		switch((vcur.x() > vcur.w() ? 1:0)|(vnex.x() > vnex.w() ? 2:0))
+		const sCLIPVERT	&cur = src[i];
+		const sCLIPVERT	&nex = (i == count-1) ? src[0]:src[i+1];
+		bool		nexOut = outside<plane>(nex.view);
+
+		switch((curOut ? 1:0)|(nexOut ? 2:0))
 		{
-			case 0:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp; break;
-			case 1:	rClip(tmp.world(), wnex, wcur, tmp.worldView(), vnex, vcur, tmp.textureView(), tnex, tcur, tmp.normalView(), nnex, ncur); dst += tmp; break;
-			case 2:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp;
-				rClip(tmp.world(), wcur, wnex, tmp.worldView(), vcur, vnex, tmp.textureView(), tcur, tnex, tmp.normalView(), ncur, nnex); dst += tmp; break;
+			case 0:	dst[dstCount++] = cur; break;
+			case 1:	intersect<plane>(dst[dstCount++], nex, cur); break;
+			case 2:	dst[dstCount++] = cur;
+				intersect<plane>(dst[dstCount++], cur, nex); break;
 		}
+
+		curOut = nexOut;
 	}
+
+	sCLIPVERT	*tmp = src;
 	src = dst;
-	return src.vertexCount();
+	dst = tmp;
+	count = dstCount;
+	return count >= 3;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-static	unsigned int	teClip(primitive<> &src)
+unsigned int	clipPolygon(sCLIPVERT *verts, const unsigned int vertexCount, const unsigned int planes)
 {
-	primitive<>	dst;
-	vert<>		tmp;
+	// Ping-pong between the caller's vertices and our own (on the stack) -- there's nothing to allocate
 
-	for (unsigned int i = 0; i < src.vertexCount(); i++)
-	{
-		Point4		&wcur = src[i].world();
-		Point4		&vcur = src[i].worldView();
-		Point2		&tcur = src[i].textureView();
-		Point3		&ncur = src[i].normalView();
-		Point4		&wnex = (i == src.vertexCount()-1) ? src[0].world():src[i+1].world();
-		Point4		&vnex = (i == src.vertexCount()-1) ? src[0].worldView():src[i+1].worldView();
-		Point2		&tnex = (i == src.vertexCount()-1) ? src[0].textureView():src[i+1].textureView();
-		Point3		&nnex = (i == src.vertexCount()-1) ? src[0].normalView():src[i+1].normalView();
-
-		switch((vcur.y() > vcur.w() ? 1:0)|(vnex.y() > vnex.w() ? 2:0))
-		{
-			case 0:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp; break;
-			case 1:	tClip(tmp.world(), wnex, wcur, tmp.worldView(), vnex, vcur, tmp.textureView(), tnex, tcur, tmp.normalView(), nnex, ncur); dst += tmp; break;
-			case 2:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp;
-				tClip(tmp.world(), wcur, wnex, tmp.worldView(), vcur, vnex, tmp.textureView(), tcur, tnex, tmp.normalView(), ncur, nnex); dst += tmp; break;
-		}
-	}
-	src = dst;
-	return src.vertexCount();
-}
+	sCLIPVERT	scratch[maxClipVertices];
+	sCLIPVERT	*src = verts;
+	sCLIPVERT	*dst = scratch;
+	unsigned int	count = vertexCount;
 
-// ---------------------------------------------------------------------------------------------------------------------------------
+	// A plane that no vertex is outside of can't clip anything, so it's skipped
 
-static	unsigned int	beClip(primitive<> &src)
-{
-	primitive<>	dst;
-	vert<>		tmp;
+	if ((planes & CLIP_NEAR)   && !clipPlane<CLIP_NEAR>  (src, dst, count)) return count;
+	if ((planes & CLIP_FAR)    && !clipPlane<CLIP_FAR>   (src, dst, count)) return count;
+	if ((planes & CLIP_LEFT)   && !clipPlane<CLIP_LEFT>  (src, dst, count)) return count;
+	if ((planes & CLIP_RIGHT)  && !clipPlane<CLIP_RIGHT> (src, dst, count)) return count;
+	if ((planes & CLIP_TOP)    && !clipPlane<CLIP_TOP>   (src, dst, count)) return count;
+	if ((planes & CLIP_BOTTOM) && !clipPlane<CLIP_BOTTOM>(src, dst, count)) return count;
+
+	// Make sure the result ends up in the caller's vertices
 
-	for (unsigned int i = 0; i < src.vertexCount(); i++)
+	if (src != verts)
 	{
-		Point4		&wcur = src[i].world();
-		Point4		&vcur = src[i].worldView();
-		Point2		&tcur = src[i].textureView();
-		Point3		&ncur = src[i].normalView();
-		Point4		&wnex = (i == src.vertexCount()-1) ? src[0].world():src[i+1].world();
-		Point4		&vnex = (i == src.vertexCount()-1) ? src[0].worldView():src[i+1].worldView();
-		Point2		&tnex = (i == src.vertexCount()-1) ? src[0].textureView():src[i+1].textureView();
-		Point3		&nnex = (i == src.vertexCount()-1) ? src[0].normalView():src[i+1].normalView();
-
-		switch((vcur.y() < -vcur.w() ? 1:0)|(vnex.y() < -vnex.w() ? 2:0))
-		{
-			case 0:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp; break;
-			case 1:	bClip(tmp.world(), wnex, wcur, tmp.worldView(), vnex, vcur, tmp.textureView(), tnex, tcur, tmp.normalView(), nnex, ncur); dst += tmp; break;
-			case 2:	tmp.world() = wcur; tmp.worldView() = vcur; tmp.textureView() = tcur; tmp.normalView() = ncur; dst += tmp;
-				bClip(tmp.world(), wcur, wnex, tmp.worldView(), vcur, vnex, tmp.textureView(), tcur, tnex, tmp.normalView(), ncur, nnex); dst += tmp; break;
-		}
+		for (unsigned int i = 0; i < count; i++) verts[i] = src[i];
 	}
-	src = dst;
-	return src.vertexCount();
-}
-
-// ---------------------------------------------------------------------------------------------------------------------------------
 
-bool	clipPrimitive(primitive<> &p)
-{
-	if (neClip(p) < 3) return false;
-	if (feClip(p) < 3) return false;
-	if (leClip(p) < 3) return false;
-	if (reClip(p) < 3) return false;
-	if (teClip(p) < 3) return false;
-	if (beClip(p) < 3) return false;
-	return true;
+	return count;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -28,14 +28,48 @@
 // Files required by this module
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-#include "primitive.h"
+#include "vmath"
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 #ifndef	_H_CLIP
 #define	_H_CLIP
 
-extern	bool	clipPrimitive(primitive<> &p);
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Outcode bits -- one for each clip plane a homogenous (view) vertex can be outside of
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+enum	{CLIP_RIGHT = 1, CLIP_LEFT = 2, CLIP_TOP = 4, CLIP_BOTTOM = 8, CLIP_NEAR = 16, CLIP_FAR = 32};
+
+static	inline	unsigned int	clipCode(const Point4 &v)
+{
+	return	(v.x() >  v.w() ? CLIP_RIGHT:0) | (v.x() < -v.w() ? CLIP_LEFT  :0) |
+		(v.y() >  v.w() ? CLIP_TOP  :0) | (v.y() < -v.w() ? CLIP_BOTTOM:0) |
+		(v.z() <    0.0 ? CLIP_NEAR :0) | (v.z() >  v.w() ? CLIP_FAR   :0);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A clipper vertex (just the view-space parts of a vert<> that the clipper interpolates)
+//
+// Every plane can add (at most) one vertex to a convex polygon, so a polygon of up to maxClipVertices - 6 vertices always fits.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+const	unsigned int	maxClipVertices = 16;
+
+typedef	struct
+{
+	Point4		world;
+	Point4		view;
+	Point2		texture;
+	Point3		normal;
+} sCLIPVERT;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Clips the polygon in 'verts' (which must have room for maxClipVertices) against the planes flagged in 'planes' (an OR of the
+// outcodes of its vertices) and returns the new vertex count. If fewer than 3 vertices remain, the polygon is gone.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+extern	unsigned int	clipPolygon(sCLIPVERT *verts, const unsigned int vertexCount, const unsigned int planes);
 
 #endif // _H_CLIP
 // ---------------------------------------------------------------------------------------------------------------------------------
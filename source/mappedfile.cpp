@@ -0,0 +1,175 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  __  __                            _ ______ _ _                          
+// |  \/  |                          | |  ____(_) |                         
+// | \  / | __ _ _ __  _ __   ___  __| | |__   _| | ___     ___ _ __  _ __  
+// | |\/| |/ _` | '_ \| '_ \ / _ \/ _` |  __| | | |/ _ \   / __| '_ \| '_ \ 
+// | |  | | (_| | |_) | |_) |  __/ (_| | |    | | |  __/ _| (__| |_) | |_) |
+// |_|  |_|\__,_| .__/| .__/ \___|\__,_|_|    |_|_|\___|(_)\___| .__/| .__/ 
+//              | |   | |                                      | |   | |    
+//              |_|   |_|                                      |_|   |_|    
+//
+// Description:
+//
+//   Read-only memory mapped files
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "texturebin.h"
+#include "mappedfile.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	MappedFile::MappedFile()
+	: _data(NULL), _size(0)
+{
+#ifdef _MSC_VER
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	MappedFile::~MappedFile()
+{
+	close();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	MappedFile::open(const std::string & filename)
+{
+	close();
+
+#ifdef _MSC_VER
+	_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE) return false;
+
+	DWORD	sizeHigh = 0;
+	DWORD	sizeLow = GetFileSize(_file, &sizeHigh);
+	if (sizeLow == INVALID_FILE_SIZE || sizeHigh) {close(); return false;}
+
+	_size = sizeLow;
+	if (!_size) return true;
+
+	_mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!_mapping) {close(); return false;}
+
+	_data = static_cast<const unsigned char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data) {close(); return false;}
+#else
+	int	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat	statbuf;
+	if (fstat(fd, &statbuf) || static_cast<unsigned long long>(statbuf.st_size) > 0xffffffffULL) {::close(fd); return false;}
+
+	_size = static_cast<unsigned int>(statbuf.st_size);
+	if (!_size) {::close(fd); return true;}
+
+	// The mapping keeps the file open on its own
+
+	void *	data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {_size = 0; return false;}
+
+	_data = static_cast<const unsigned char *>(data);
+#endif
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	MappedFile::close()
+{
+#ifdef _MSC_VER
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+#else
+	if (_data) munmap(const_cast<unsigned char *>(_data), _size);
+#endif
+
+	_data = NULL;
+	_size = 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	unsigned int	rotl(const unsigned int x, const int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static	inline	unsigned int	finalMix(unsigned int h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Two lanes of MurmurHash3-style mixing (each with its own constants) over 4 bytes at a time. This isn't meant to stand up to an
+// attacker, just to be quick -- it runs at several gigabytes per second, so hashing a scene costs far less than loading it.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	hashData(const unsigned char * data, const unsigned int size, unsigned int hash[2])
+{
+	unsigned int	h1 = 0x9747b28c;
+	unsigned int	h2 = 0x2545f491;
+	unsigned int	i = 0;
+
+	for (; i + 4 <= size; i += 4)
+	{
+		unsigned int	k;
+		memcpy(&k, data + i, sizeof(k));
+		h1 = rotl(h1 ^ (rotl(k * 0xcc9e2d51, 15) * 0x1b873593), 13) * 5 + 0xe6546b64;
+		h2 = rotl(h2 ^ (rotl(k * 0x85ebca6b, 17) * 0xc2b2ae35), 15) * 9 + 0x52dce729;
+	}
+
+	// The last few bytes
+
+	unsigned int	k = 0;
+	for (unsigned int j = 0; i + j < size; ++j) k |= static_cast<unsigned int>(data[i + j]) << (j * 8);
+	h1 ^= rotl(k * 0xcc9e2d51, 15) * 0x1b873593;
+	h2 ^= rotl(k * 0x85ebca6b, 17) * 0xc2b2ae35;
+
+	// The size goes in too, so trailing zeros count
+
+	hash[0] = finalMix(h1 ^ size);
+	hash[1] = finalMix(h2 ^ size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// MappedFile.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  __  __                            _ ______ _ _          _     
+// |  \/  |                          | |  ____(_) |        | |    
+// | \  / | __ _ _ __  _ __   ___  __| | |__   _| | ___    | |__  
+// | |\/| |/ _` | '_ \| '_ \ / _ \/ _` |  __| | | |/ _ \   | '_ \ 
+// | |  | | (_| | |_) | |_) |  __/ (_| | |    | | |  __/ _ | | | |
+// |_|  |_|\__,_| .__/| .__/ \___|\__,_|_|    |_|_|\___|(_)|_| |_|
+//              | |   | |                                         
+//              |_|   |_|                                         
+//
+// Description:
+//
+//   Read-only memory mapped files
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_MAPPEDFILE
+#define _H_MAPPEDFILE
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A whole file, mapped (read-only) into memory. The pages are only read from disk as they're touched, so opening a large file is
+// cheap, and the data is shared with the system's file cache rather than copied.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	MappedFile
+{
+public:
+	// Construction/Destruction
+
+					MappedFile();
+virtual					~MappedFile();
+
+	// Implementation
+
+	// Maps the file, returning false if it can't be (an empty file maps to no data at all.) Any previously opened file is
+	// closed first.
+
+virtual		bool			open(const std::string & filename);
+
+	// Unmaps the file. Any pointers into the data are invalid from here on.
+
+virtual		void			close();
+
+	// Accessors
+
+inline	const	unsigned char *		data() const		{return _data;}
+inline	const	unsigned int		size() const		{return _size;}
+
+private:
+	// Explicitly disallow copying this object (it owns the mapping)
+
+					MappedFile(const MappedFile & rhs) {}
+inline		MappedFile &		operator=(const MappedFile & rhs) {MappedFile * errptr = 0; return *errptr;}
+
+	// Data members
+
+		const unsigned char *	_data;
+		unsigned int		_size;
+#ifdef _MSC_VER
+		void *			_file;		// HANDLEs
+		void *			_mapping;
+#endif
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A 64-bit hash (as two 32-bit halves) of a block of data, used to tell whether a cached file is still current
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	hashData(const unsigned char * data, const unsigned int size, unsigned int hash[2]);
+
+#endif // _H_MAPPEDFILE
+// ---------------------------------------------------------------------------------------------------------------------------------
+// MappedFile.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,240 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  _____ _          _                         
+// |  __ (_)        | |                        
+// | |__) |__  _____| |___     ___ _ __  _ __  
+// |  ___/ \ \/ / _ \ / __|   / __| '_ \| '_ \ 
+// | |   | |>  <  __/ \__ \ _| (__| |_) | |_) |
+// |_|   |_/_/\_\___|_|___/(_)\___| .__/| .__/ 
+//                                | |   | |    
+//                                |_|   |_|    
+//
+// Description:
+//
+//   The SSE2 pixel format routines (see Pixels.h)
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "pixels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define	HAVE_PIXELS_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_PIXELS_SSE2
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Packs 4 pixels (0x00RRGGBB) into 12 bytes of RGB (in memory order) in the low 12 bytes of the result
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	__m128i	packRGB(const __m128i pixels)
+{
+	// Swap R & B, so the bytes of each pixel are in memory order
+
+	__m128i	lowByte = _mm_set1_epi32(0xff);
+	__m128i	rgb = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), lowByte), _mm_and_si128(pixels, _mm_set1_epi32(0xff00))), _mm_slli_epi32(_mm_and_si128(pixels, lowByte), 16));
+
+	// Squeeze out the unused byte of each pixel -- first within each half (6 bytes each), then the halves together
+
+	__m128i	halves = _mm_or_si128(_mm_and_si128(rgb, _mm_set_epi32(0, 0x00ffffff, 0, 0x00ffffff)),
+	                              _mm_and_si128(_mm_srli_epi64(rgb, 8), _mm_set_epi32(0x0000ffff, static_cast<int>(0xff000000), 0x0000ffff, static_cast<int>(0xff000000))));
+	return _mm_or_si128(_mm_move_epi64(halves), _mm_and_si128(_mm_srli_si128(halves, 2), _mm_set_epi32(-1, -1, -1, 0)));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Unpacks 12 bytes of RGB (the low 12 bytes of the input) into 4 pixels (0x00RRGGBB)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	__m128i	unpackRGB(const __m128i bytes)
+{
+	// One pixel per dword (still in memory order, with junk in the top byte)
+
+	__m128i	rgb = _mm_unpacklo_epi64(_mm_unpacklo_epi32(bytes, _mm_srli_si128(bytes, 3)), _mm_unpacklo_epi32(_mm_srli_si128(bytes, 6), _mm_srli_si128(bytes, 9)));
+
+	// Swap R & B
+
+	__m128i	lowByte = _mm_set1_epi32(0xff);
+	return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(rgb, lowByte), 16), _mm_and_si128(rgb, _mm_set1_epi32(0xff00))), _mm_and_si128(_mm_srli_epi32(rgb, 16), lowByte));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Divides the accumulation buffer entries for 4 pixels by the sample count, and packs them into 12 bytes of RGB (in the low 12 bytes
+// of the result.)
+//
+// The division is done in floating point, as (entry + 0.5) * (1 / samples). The fraction of that is always at least 0.5 / samples
+// away from a whole number, which is far more than the floating point error (the entries are at most 255 * samples) so it truncates
+// to exactly the same integer as the integer division. (A plain division isn't used, since -ffast-math is free to turn it into
+// a multiplication by the reciprocal, which isn't exact.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	__m128i	resolveRGB(const unsigned int * accum, const __m128 overSamples)
+{
+	const	__m128i *	src = reinterpret_cast<const __m128i *>(accum);
+	__m128	half = _mm_set1_ps(0.5f);
+	__m128i	q0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_loadu_si128(src + 0)), half), overSamples));
+	__m128i	q1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_loadu_si128(src + 1)), half), overSamples));
+	__m128i	q2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_loadu_si128(src + 2)), half), overSamples));
+	return _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q2));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Stores the low 12 bytes
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	void	store12(unsigned char * dst, const __m128i bytes)
+{
+	_mm_storel_epi64(reinterpret_cast<__m128i *>(dst), bytes);
+	_mm_store_ss(reinterpret_cast<float *>(dst + 8), _mm_castsi128_ps(_mm_srli_si128(bytes, 8)));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	convert32To24SSE2(unsigned char * dest, const unsigned int * source, const unsigned int pixCount)
+{
+	const unsigned int *	src = source;
+	unsigned char *		dst = dest;
+	unsigned int		i = 0;
+
+	for (; i + 4 <= pixCount; i += 4, src += 4, dst += 12)
+	{
+		store12(dst, packRGB(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src))));
+	}
+
+	for (; i < pixCount; ++i, ++src, dst += 3)
+	{
+		const unsigned int &	pix = *src;
+		dst[0] = (pix>>16) & 0xff;
+		dst[1] = (pix>> 8) & 0xff;
+		dst[2] = (pix>> 0) & 0xff;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	convert24To32SSE2(unsigned int * dest, const unsigned char * source, const unsigned int pixCount)
+{
+	const unsigned char *	src = source;
+	unsigned int *		dst = dest;
+	unsigned int		i = 0;
+
+	// Each group reads 16 bytes (4 bytes past the 4 pixels it converts)
+
+	for (; i + 6 <= pixCount; i += 4, src += 12, dst += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), unpackRGB(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src))));
+	}
+
+	for (; i < pixCount; ++i, src += 3, ++dst)
+	{
+		*dst = (src[0]<<16) | (src[1]<<8) | src[2];
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	accumulateBufferSSE2(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int pixCount)
+{
+	unsigned int *		dst = accumBuffer;
+	const unsigned int *	src = frameBuffer;
+	unsigned int		i = 0;
+
+	for (; i + 4 <= pixCount; i += 4, src += 4, dst += 12)
+	{
+		// Pack the pixels into RGB bytes, then widen them back out into one dword per component
+
+		__m128i		zero = _mm_setzero_si128();
+		__m128i		rgb = packRGB(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+		__m128i		lo = _mm_unpacklo_epi8(rgb, zero);
+		__m128i		hi = _mm_unpackhi_epi8(rgb, zero);
+		__m128i *	acc = reinterpret_cast<__m128i *>(dst);
+		_mm_storeu_si128(acc + 0, _mm_add_epi32(_mm_loadu_si128(acc + 0), _mm_unpacklo_epi16(lo, zero)));
+		_mm_storeu_si128(acc + 1, _mm_add_epi32(_mm_loadu_si128(acc + 1), _mm_unpackhi_epi16(lo, zero)));
+		_mm_storeu_si128(acc + 2, _mm_add_epi32(_mm_loadu_si128(acc + 2), _mm_unpacklo_epi16(hi, zero)));
+	}
+
+	for (; i < pixCount; ++i, ++src)
+	{
+		const unsigned int &	pix = *src;
+		*(dst++) += (pix>>16) & 0xff;
+		*(dst++) += (pix>> 8) & 0xff;
+		*(dst++) += (pix    ) & 0xff;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	downsampleSSE2(unsigned int * buffer, const unsigned int pixCount, const unsigned int totalSamples)
+{
+	const unsigned int *	src = buffer;
+	unsigned int *		dst = buffer;
+	unsigned int		i = 0;
+	__m128			overSamples = _mm_set1_ps(1.0f / static_cast<float>(totalSamples));
+
+	// This is done in place -- each group of pixels is written well behind the entries still to be read
+
+	for (; i + 4 <= pixCount; i += 4, src += 12, dst += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), unpackRGB(resolveRGB(src, overSamples)));
+	}
+
+	for (; i < pixCount; ++i, ++dst)
+	{
+		unsigned int	r = *(src++) / totalSamples;
+		unsigned int	g = *(src++) / totalSamples;
+		unsigned int	b = *(src++) / totalSamples;
+		*dst = (r << 16) | (g << 8) | b;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	downsampleTo24SSE2(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int pixCount, const unsigned int totalSamples)
+{
+	const unsigned int *	src = accumBuffer;
+	unsigned char *		dst = dest;
+	unsigned int		i = 0;
+	__m128			overSamples = _mm_set1_ps(1.0f / static_cast<float>(totalSamples));
+
+	for (; i + 4 <= pixCount; i += 4, src += 12, dst += 12)
+	{
+		store12(dst, resolveRGB(src, overSamples));
+	}
+
+	for (; i < pixCount; ++i, dst += 3)
+	{
+		dst[0] = static_cast<unsigned char>(*(src++) / totalSamples);
+		dst[1] = static_cast<unsigned char>(*(src++) / totalSamples);
+		dst[2] = static_cast<unsigned char>(*(src++) / totalSamples);
+	}
+}
+
+#else
+
+// Never called (see Pixels.h)
+
+void	convert32To24SSE2(unsigned char * dest, const unsigned int * source, const unsigned int pixCount) {}
+void	convert24To32SSE2(unsigned int * dest, const unsigned char * source, const unsigned int pixCount) {}
+void	accumulateBufferSSE2(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int pixCount) {}
+void	downsampleSSE2(unsigned int * buffer, const unsigned int pixCount, const unsigned int totalSamples) {}
+void	downsampleTo24SSE2(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int pixCount, const unsigned int totalSamples) {}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Pixels.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  _____ _          _         _     
+// |  __ (_)        | |       | |    
+// | |__) |__  _____| |___    | |__  
+// |  ___/ \ \/ / _ \ / __|   | '_ \ 
+// | |   | |>  <  __/ \__ \ _ | | | |
+// |_|   |_/_/\_\___|_|___/(_)|_| |_|
+//                                   
+//                                   
+//
+// Description:
+//
+//   SIMD versions of the pixel format routines in Render (see Render.h for what they do)
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_PIXELS
+#define _H_PIXELS
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Module setup (required includes, macros, etc.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Like the span shaders (see Span.h) these are compiled with different instruction sets, so this has no dependencies.
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Prototypes
+//
+// Render calls these in place of its own (scalar) loops, following pixelRoutines() (see Span.h), which defaults to the best ones the
+// processor supports whichever span shader is selected. They're built under the same conditions as the span shaders, so they're
+// always there when the matching span shader is. All of them produce exactly the same results as the scalar loops.
+//
+// These work on a flat run of pixels (width * height of them.) The accumulation buffers hold three dwords per pixel (R, G, B.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	convert32To24SSE2(unsigned char * dest, const unsigned int * source, const unsigned int pixCount);
+void	convert24To32SSE2(unsigned int * dest, const unsigned char * source, const unsigned int pixCount);
+void	accumulateBufferSSE2(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int pixCount);
+void	downsampleSSE2(unsigned int * buffer, const unsigned int pixCount, const unsigned int totalSamples);
+void	downsampleTo24SSE2(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int pixCount, const unsigned int totalSamples);
+
+void	convert32To24AVX2(unsigned char * dest, const unsigned int * source, const unsigned int pixCount);
+void	convert24To32AVX2(unsigned int * dest, const unsigned char * source, const unsigned int pixCount);
+void	accumulateBufferAVX2(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int pixCount);
+void	downsampleAVX2(unsigned int * buffer, const unsigned int pixCount, const unsigned int totalSamples);
+void	downsampleTo24AVX2(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int pixCount, const unsigned int totalSamples);
+
+#endif // _H_PIXELS
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Pixels.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
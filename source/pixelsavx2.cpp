@@ -0,0 +1,238 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  _____ _          _         __      ____   _____                      
+// |  __ (_)        | |       /\ \    / /\ \ / /__ \                     
+// | |__) |__  _____| |___   /  \ \  / /  \ V /   ) |    ___ _ __  _ __  
+// |  ___/ \ \/ / _ \ / __| / /\ \ \/ /    > <   / /    / __| '_ \| '_ \ 
+// | |   | |>  <  __/ \__ \/ ____ \  /    / . \ / /_  _| (__| |_) | |_) |
+// |_|   |_/_/\_\___|_|___/_/    \_\/    /_/ \_\____|(_)\___| .__/| .__/ 
+//                                                          | |   | |    
+//                                                          |_|   |_|    
+//
+// Description:
+//
+//   The AVX2 pixel format routines (see Pixels.h)
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+//   Like SpanAVX2.cpp, this is compiled with AVX2 enabled (see the Makefile) and only ever called when the processor supports it,
+//   so it includes nothing but its own header.
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "pixels.h"
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define	HAVE_PIXELS_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef HAVE_PIXELS_AVX2
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Byte shuffles (within each 128-bit lane)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// 4 pixels (0x00RRGGBB) to 12 bytes of RGB (in memory order)
+
+static	inline	__m256i	packRGBShuffle()
+{
+	return _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+}
+
+// 12 bytes of RGB to 4 pixels
+
+static	inline	__m256i	unpackRGBShuffle()
+{
+	return _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+	                        2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Divides the accumulation buffer entries for 8 pixels by the sample count, returning the 24 bytes of RGB spread across the dwords
+// of the result in the order 0, 2, 4, 4, 1, 3, 5, 5 (see the SSE2 resolveRGB() in Pixels.cpp for why the division is exact)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	__m256i	resolveRGB(const unsigned int * accum, const __m256 overSamples)
+{
+	const	__m256i *	src = reinterpret_cast<const __m256i *>(accum);
+	__m256	half = _mm256_set1_ps(0.5f);
+	__m256i	q0 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(src + 0)), half), overSamples));
+	__m256i	q1 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(src + 1)), half), overSamples));
+	__m256i	q2 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(src + 2)), half), overSamples));
+	return _mm256_packus_epi16(_mm256_packs_epi32(q0, q1), _mm256_packs_epi32(q2, q2));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	convert32To24AVX2(unsigned char * dest, const unsigned int * source, const unsigned int pixCount)
+{
+	const unsigned int *	src = source;
+	unsigned char *		dst = dest;
+	unsigned int		i = 0;
+
+	// Each group writes 28 bytes (the second half overwrites the 4 junk bytes after the first half)
+
+	for (; i + 10 <= pixCount; i += 8, src += 8, dst += 24)
+	{
+		__m256i	rgb = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)), packRGBShuffle());
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(rgb));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 12), _mm256_extracti128_si256(rgb, 1));
+	}
+
+	for (; i < pixCount; ++i, ++src, dst += 3)
+	{
+		const unsigned int &	pix = *src;
+		dst[0] = (pix>>16) & 0xff;
+		dst[1] = (pix>> 8) & 0xff;
+		dst[2] = (pix>> 0) & 0xff;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	convert24To32AVX2(unsigned int * dest, const unsigned char * source, const unsigned int pixCount)
+{
+	const unsigned char *	src = source;
+	unsigned int *		dst = dest;
+	unsigned int		i = 0;
+
+	// Each group reads 28 bytes (4 bytes past the 8 pixels it converts)
+
+	for (; i + 10 <= pixCount; i += 8, src += 24, dst += 8)
+	{
+		__m256i	rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src))), _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 12)), 1);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_shuffle_epi8(rgb, unpackRGBShuffle()));
+	}
+
+	for (; i < pixCount; ++i, src += 3, ++dst)
+	{
+		*dst = (src[0]<<16) | (src[1]<<8) | src[2];
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	accumulateBufferAVX2(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int pixCount)
+{
+	unsigned int *		dst = accumBuffer;
+	const unsigned int *	src = frameBuffer;
+	unsigned int		i = 0;
+
+	// Each lane of pixels spreads its 12 components across three vectors (one dword each), which are then recombined across the
+	// lanes into the 24 consecutive accumulation buffer entries for the 8 pixels
+
+	__m256i	spread0 = _mm256_setr_epi8(2, -1, -1, -1, 1, -1, -1, -1, 0, -1, -1, -1, 6, -1, -1, -1,
+	                                   2, -1, -1, -1, 1, -1, -1, -1, 0, -1, -1, -1, 6, -1, -1, -1);
+	__m256i	spread1 = _mm256_setr_epi8(5, -1, -1, -1, 4, -1, -1, -1, 10, -1, -1, -1, 9, -1, -1, -1,
+	                                   5, -1, -1, -1, 4, -1, -1, -1, 10, -1, -1, -1, 9, -1, -1, -1);
+	__m256i	spread2 = _mm256_setr_epi8(8, -1, -1, -1, 14, -1, -1, -1, 13, -1, -1, -1, 12, -1, -1, -1,
+	                                   8, -1, -1, -1, 14, -1, -1, -1, 13, -1, -1, -1, 12, -1, -1, -1);
+
+	for (; i + 8 <= pixCount; i += 8, src += 8, dst += 24)
+	{
+		__m256i		pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+		__m256i		s0 = _mm256_shuffle_epi8(pixels, spread0);
+		__m256i		s1 = _mm256_shuffle_epi8(pixels, spread1);
+		__m256i		s2 = _mm256_shuffle_epi8(pixels, spread2);
+		__m256i *	acc = reinterpret_cast<__m256i *>(dst);
+		_mm256_storeu_si256(acc + 0, _mm256_add_epi32(_mm256_loadu_si256(acc + 0), _mm256_permute2x128_si256(s0, s1, 0x20)));
+		_mm256_storeu_si256(acc + 1, _mm256_add_epi32(_mm256_loadu_si256(acc + 1), _mm256_permute2x128_si256(s2, s0, 0x30)));
+		_mm256_storeu_si256(acc + 2, _mm256_add_epi32(_mm256_loadu_si256(acc + 2), _mm256_permute2x128_si256(s1, s2, 0x31)));
+	}
+
+	for (; i < pixCount; ++i, ++src)
+	{
+		const unsigned int &	pix = *src;
+		*(dst++) += (pix>>16) & 0xff;
+		*(dst++) += (pix>> 8) & 0xff;
+		*(dst++) += (pix    ) & 0xff;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	downsampleAVX2(unsigned int * buffer, const unsigned int pixCount, const unsigned int totalSamples)
+{
+	const unsigned int *	src = buffer;
+	unsigned int *		dst = buffer;
+	unsigned int		i = 0;
+	__m256			overSamples = _mm256_set1_ps(1.0f / static_cast<float>(totalSamples));
+
+	// Put bytes 0-15 of the RGB in the first lane and bytes 12-27 in the second, ready to be unpacked into pixels
+
+	__m256i			order = _mm256_setr_epi32(0, 4, 1, 5, 5, 2, 6, 6);
+
+	// This is done in place -- each group of pixels is written well behind the entries still to be read
+
+	for (; i + 8 <= pixCount; i += 8, src += 24, dst += 8)
+	{
+		__m256i	rgb = _mm256_permutevar8x32_epi32(resolveRGB(src, overSamples), order);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_shuffle_epi8(rgb, unpackRGBShuffle()));
+	}
+
+	for (; i < pixCount; ++i, ++dst)
+	{
+		unsigned int	r = *(src++) / totalSamples;
+		unsigned int	g = *(src++) / totalSamples;
+		unsigned int	b = *(src++) / totalSamples;
+		*dst = (r << 16) | (g << 8) | b;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	downsampleTo24AVX2(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int pixCount, const unsigned int totalSamples)
+{
+	const unsigned int *	src = accumBuffer;
+	unsigned char *		dst = dest;
+	unsigned int		i = 0;
+	__m256			overSamples = _mm256_set1_ps(1.0f / static_cast<float>(totalSamples));
+
+	// Put the 24 bytes of RGB in order
+
+	__m256i			order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	for (; i + 8 <= pixCount; i += 8, src += 24, dst += 24)
+	{
+		__m256i	rgb = _mm256_permutevar8x32_epi32(resolveRGB(src, overSamples), order);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(rgb));
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 16), _mm256_extracti128_si256(rgb, 1));
+	}
+
+	for (; i < pixCount; ++i, dst += 3)
+	{
+		dst[0] = static_cast<unsigned char>(*(src++) / totalSamples);
+		dst[1] = static_cast<unsigned char>(*(src++) / totalSamples);
+		dst[2] = static_cast<unsigned char>(*(src++) / totalSamples);
+	}
+}
+
+#else
+
+// Never called (see Pixels.h)
+
+void	convert32To24AVX2(unsigned char * dest, const unsigned int * source, const unsigned int pixCount) {}
+void	convert24To32AVX2(unsigned int * dest, const unsigned char * source, const unsigned int pixCount) {}
+void	accumulateBufferAVX2(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int pixCount) {}
+void	downsampleAVX2(unsigned int * buffer, const unsigned int pixCount, const unsigned int totalSamples) {}
+void	downsampleTo24AVX2(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int pixCount, const unsigned int totalSamples) {}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// PixelsAVX2.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
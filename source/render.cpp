@@ -31,159 +31,468 @@
 
 #include "texturebin.h"
 #include "render.h"
+#include "scene.h"
+#include "stats.h"
 #include "jpeg.h"
 #include "3ds.h"
 #include "clip.h"
 #include "tmap.h"
+#include "span.h"
+#include "pixels.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Constants
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// When rendering with multiple threads, the screen is split into this many bands per thread, so that a thread that finishes its
+// (cheap) bands early can help out with the rest
+
+static	const	unsigned int	bandsPerThread = 4;
+
+// Multisampled rendering keeps every subsample of a band of scanlines in memory (per thread), so the bands are limited to this
+// many subsamples
+
+static	const	unsigned int	multisampleBandSamples = 1024 * 1024;
+
+// Adaptive antialiasing treats neighboring pixels from different polygons as an edge when their depths (1/z) differ by more than
+// this fraction
+
+static	const	float		adaptiveDepthThreshold = 0.001f;
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 	Render::Render()
+	: _antialiasMode(AA_SUPERSAMPLE), _verbose(true), _depthPrepass(false), _stats(NULL)
 {
+	gBuffer().samples = NULL;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 	Render::~Render()
 {
+	delete[] gBuffer().samples;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-void	Render::renderScene(const std::string & textureFilename, const std::string & imageFilename, const std::string & sceneFilename, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const unsigned int quality, const sPHONG & phong)
+void	Render::renderScene(const std::string & textureFilename, const std::string & imageFilename, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const unsigned int quality, const sPHONG & phong)
 {
-	// Populate these into the camera
-
-	Camera	camera;
-	camera.width = width;
-	camera.height = height;
-	camera.oversampleX = oversampleX;
-	camera.oversampleY = oversampleY;
+	StageTimer	totalTimer(stats(), Stats::STAGE_TOTAL);
 
 	// Find the short name of the file
 
 	std::string	shortName = textureFilename;
 	std::string::size_type	idx = shortName.find_last_of("\\/");
 	if (idx != std::string::npos) shortName.erase(0, idx+1);
-	printf("%s: ", shortName.c_str());
+	if (verbose()) printf("%s: ", shortName.c_str());
 
 	Jpeg	texture;
-	printf("read...");
+	if (verbose()) printf("read...");
 	{
+		StageTimer	timer(stats(), Stats::STAGE_READ);
 		texture.read(textureFilename);
 	}
 
-	std::vector<primitive<> >	primitives;
-	std::vector<sLIGHT>		lights;
-	printf("3D import...");
+	Jpeg	image(width, height);
+	if (verbose()) printf("render...");
 	{
-		importScene(sceneFilename, primitives, lights, camera.position, camera.direction, camera.bank, camera.fov);
+		renderTexture(image, texture, scene, width, height, oversampleX, oversampleY, phong);
 	}
 
-	std::vector<ShadowMap>	shadowMaps;
-	printf("shadows...");
+	if (verbose()) printf("write...");
 	{
-		// Render the shadow maps
+		StageTimer	timer(stats(), Stats::STAGE_WRITE);
+		image.write(imageFilename, quality);
+	}
 
-		for (unsigned int i = 0; i < lights.size(); ++i)
+	if (verbose()) printf("done.\n");
+	{
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::renderSceneDeferred(const std::string & textureFilename, const std::string & imageFilename, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const unsigned int quality, const sPHONG & phong)
+{
+	StageTimer	totalTimer(stats(), Stats::STAGE_TOTAL);
+
+	// Find the short name of the file
+
+	std::string	shortName = textureFilename;
+	std::string::size_type	idx = shortName.find_last_of("\\/");
+	if (idx != std::string::npos) shortName.erase(0, idx+1);
+	if (verbose()) printf("%s: ", shortName.c_str());
+
+	// The first time through, we need to light the scene into the G-buffer
+
+	if (!gBuffer().samples)
+	{
+		if (verbose()) printf("lighting...");
 		{
-			sLIGHT &	light = lights[i];
+			lightScene(scene, width, height, oversampleX, oversampleY, phong);
+		}
+	}
 
-			// Treat the light like a camera
+	Jpeg	texture;
+	if (verbose()) printf("read...");
+	{
+		StageTimer	timer(stats(), Stats::STAGE_READ);
+		texture.read(textureFilename);
+	}
+
+	Jpeg	image(width, height);
+	if (verbose()) printf("shade...");
+	{
+		renderTextureDeferred(image, texture, scene, width, height, oversampleX, oversampleY, phong);
+	}
 
-			ShadowMap	map;
-			map.camera.position = light.pos;
-			map.camera.direction = light.dir;
-			map.camera.bank = 0;
-			map.camera.fov = 0.52f;
-			map.camera.height = phong.shadowMapRes;
-			map.camera.width = phong.shadowMapRes;
-			map.camera.oversampleX = 1;
-			map.camera.oversampleY = 1;
-			map.xform = map.camera.calcTransform();
+	if (verbose()) printf("write...");
+	{
+		StageTimer	timer(stats(), Stats::STAGE_WRITE);
+		image.write(imageFilename, quality);
+	}
+
+	if (verbose()) printf("done.\n");
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::renderTexture(Jpeg & image, const Jpeg & texture, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const sPHONG & phong)
+{
+	// The scene's camera, setup for this render
 
-			// Transform and clip the polygons
+	Camera	camera = scene.camera(width, height, oversampleX, oversampleY);
+	Matrix4	xform = camera.calcTransform();
+
+	// Transform and clip the polygons (the primitives are only read, so the scene can be shared with other renders that are
+	// running at the same time)
+
+	{
+		StageTimer	timer(stats(), Stats::STAGE_TRANSFORM);
+		transformAndClip(vertexArena(), camera, xform, texture.width(), texture.height(), scene.primitives(), scene.meshes(), &scene.bvh(), stats());
+	}
+
+	// Render the polygons
+
+	{
+		StageTimer	timer(stats(), Stats::STAGE_RENDER);
+		if (antialiasMode() == AA_MULTISAMPLE)	renderGeometryMultisampled(image, camera, phong, vertexArena(), scene.lights(), scene.shadowMaps(), texture, threads(), stats());
+		else					renderGeometry(image, camera, phong, vertexArena(), scene.lights(), scene.shadowMaps(), texture, threads(), antialiasMode() == AA_ADAPTIVE, verbose(), stats(), depthPrepass());
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::renderTextureDeferred(Jpeg & image, const Jpeg & texture, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const sPHONG & phong)
+{
+	if (!gBuffer().samples) lightScene(scene, width, height, oversampleX, oversampleY, phong);
+
+	renderTextureDeferred(image, texture, gBuffer());
+}
 
-			unsigned int	renderPolygonCount;
-			sVERT *		renderVertices = transformAndClip(map.camera, map.xform, texture, primitives, renderPolygonCount);
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-			// Render the polygons
+void	Render::renderTextureDeferred(Jpeg & image, const Jpeg & texture, const GBuffer & gBuffer)
+{
+	StageTimer	timer(stats(), Stats::STAGE_RENDER);
+	shadeGBuffer(image, gBuffer, texture, threads());
+}
 
-			map.zBuffer = new float[map.camera.width * map.camera.height];
-			memset(map.zBuffer, 0, map.camera.width * map.camera.height * sizeof(float));
-			renderShadowMap(map, map.camera, renderVertices, renderPolygonCount);
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-#if 0
-Jpeg	foo(map.camera.width,map.camera.height);
-float	zmin, zmax;
-for (unsigned int j = 0; j < map.camera.width*map.camera.height; ++j)
+void	Render::lightScene(Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const sPHONG & phong)
 {
-	if (!j || map.zBuffer[j] < zmin) zmin = map.zBuffer[j];
-	if (!j || map.zBuffer[j] > zmax) zmax = map.zBuffer[j];
+	StageTimer	timer(stats(), Stats::STAGE_LIGHTING);
+
+	Camera &	camera = gBuffer().camera;
+	camera = scene.camera(width, height, oversampleX, oversampleY);
+	Matrix4		xform = camera.calcTransform();
+
+	// Transform and clip the polygons, with normalized texture coordinates
+
+	transformAndClip(vertexArena(), camera, xform, 1, 1, scene.primitives(), scene.meshes(), &scene.bvh(), stats());
+
+	// Light the polygons into the G-buffer
+
+	renderGBuffer(gBuffer(), phong, vertexArena(), scene.lights(), scene.shadowMaps(), threads(), verbose(), stats());
 }
-for (unsigned int j = 0; j < map.camera.width*map.camera.height; ++j)
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+Camera	Render::shadowMapCamera(const sLIGHT & light, const sPHONG & phong)
 {
-	float	zzz = (map.zBuffer[j] - zmin) / (zmax-zmin) * 255;
-	int	iz = (int) zzz;
-	foo.buffer()[j*3+0] = iz;
-	foo.buffer()[j*3+1] = iz;
-	foo.buffer()[j*3+2] = iz;
+	// Treat the light like a camera
+
+	Camera	camera;
+	camera.position = light.pos;
+	camera.direction = light.dir;
+	camera.bank = 0;
+	camera.fov = 0.52f;
+	camera.height = phong.shadowMapRes;
+	camera.width = phong.shadowMapRes;
+	camera.oversampleX = 1;
+	camera.oversampleY = 1;
+	return camera;
 }
-char	dsp[90];
-sprintf(dsp, "j:\\%d_foo.jpg", i);
-foo.write(dsp);
-#endif
 
-			// Add this shadow map
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Rasterizes the shadow maps. Each task renders one band of scanlines of one shadow map, so with fewer lights than threads, the
+// maps are split into bands (and the polygons binned into them.) The polygons are drawn in their original order within each band,
+// so the z-buffers are exactly the same as rendering each map in one go.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	ShadowMapJob : public ThreadJob
+{
+public:
+virtual		void		run(const unsigned int task, const unsigned int thread)
+		{
+			unsigned int	light = task / bandCount;
+			unsigned int	band = task % bandCount;
+			ShadowMap &	map = (*shadowMaps)[firstMap + light];
+
+			int		top = band * bandHeight;
+			int		bottom = top + bandHeight;
+			if (bottom > static_cast<int>(map.camera.height)) bottom = map.camera.height;
 
-			shadowMaps.push_back(map);
+			// Clear this band out...
 
-			// Done with this
+			memset(map.zBuffer + top * map.camera.width, 0, (bottom - top) * map.camera.width * sizeof(float));
+			sHIZ *	hiz = hiZs.empty() ? NULL : &hiZs[light];
+			if (hiz) clearHiZ(*hiz, top, bottom);
+
+			// Render the polygons that touch this band (from a copy, since the rasterizer writes to the vertices)
+
+			sRASTERCOUNT	count = {0, 0};
+			const VertexArena &			polygons = (*arenas)[light];
+			const std::vector<unsigned int> &	bin = bins[light][band];
+			for (unsigned int i = 0; i < bin.size(); i++)
+			{
+				sVERT		verts[maxClipVertices];
+				const sVERT *	src = polygons.vertices(bin[i]);
+				unsigned int	vertexCount = polygons.vertexCount(bin[i]);
+				for (unsigned int j = 0; j < vertexCount; ++j) verts[j] = src[j];
+				drawShadowMapPolygon(verts, vertexCount, map.zBuffer, map.camera.width, top, bottom, stats ? &count : NULL, hiz);
+			}
 
-			delete[] renderVertices;
+			if (stats)
+			{
+				threads->lock();
+				stats->shadowTexels() += count.written;
+				threads->unlock();
+			}
 		}
-	}
 
-	Jpeg	image(width, height);
-	printf("render...");
+		std::vector<ShadowMap> *	shadowMaps;
+		unsigned int		firstMap;
+	const	std::vector<VertexArena> *	arenas;
+		std::vector<std::vector<std::vector<unsigned int> > >	bins;
+		std::vector<sHIZ>	hiZs;
+		unsigned int		bandCount;
+		unsigned int		bandHeight;
+		ThreadPool *		threads;
+		Stats *			stats;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::renderShadowMaps(std::vector<ShadowMap> & shadowMaps, const std::vector<primitive<> > & primitives, const std::vector<sMESH> & meshes, const Bvh * bvh, const std::vector<sLIGHT> & lights, const sPHONG & phong, ThreadPool & threads, Stats * stats)
+{
+	// The polygons are transformed into each light's view one light at a time (into an arena for each light.) The rasterizing is
+	// where the time goes at high resolutions, and that's done concurrently.
+
+	ShadowMapJob	job;
+	job.shadowMaps = &shadowMaps;
+	job.firstMap = static_cast<unsigned int>(shadowMaps.size());
+	job.threads = &threads;
+	job.stats = stats;
+
+	std::vector<VertexArena>	arenas(lights.size());
+	job.arenas = &arenas;
+
+	for (unsigned int i = 0; i < lights.size(); ++i)
 	{
-		Matrix4	xform = camera.calcTransform();
+		ShadowMap	map;
+		map.camera = shadowMapCamera(lights[i], phong);
+		map.xform = map.camera.calcTransform();
+
+		// Transform and clip the polygons (just the ones within the light's range)
 
-		// Transform and clip the polygons
+		transformAndClip(arenas[i], map.camera, map.xform, 1, 1, primitives, meshes, bvh, NULL, lights[i].outerRange);
 
-		unsigned int	renderPolygonCount;
-		sVERT *		renderVertices = transformAndClip(camera, xform, texture, primitives, renderPolygonCount);
+		// Add this shadow map (it's cleared as it's rendered)
 
-		// Render the polygons
+		map.zBuffer = new float[map.camera.width * map.camera.height];
+		shadowMaps.push_back(map);
+	}
+
+	if (!lights.size()) return;
 
-		renderGeometry(image, camera, phong, renderVertices, renderPolygonCount, lights, shadowMaps, texture);
+	// Render the polygons -- one light per task, or if there aren't enough lights to keep all of the threads busy, one band of
+	// a light per task (all of the shadow maps are the same size, so they're all banded the same way)
 
-		// Done with this
+	const Camera &	camera = shadowMaps[job.firstMap].camera;
+	unsigned int	threadCount = threads.threadCount();
+	unsigned int	bandCount = 1;
+	if (threadCount > 1) bandCount = (threadCount * bandsPerThread + static_cast<unsigned int>(lights.size()) - 1) / static_cast<unsigned int>(lights.size());
 
-		delete[] renderVertices;
+	job.bins.resize(lights.size());
+	for (unsigned int i = 0; i < lights.size(); ++i)
+	{
+		binPolygons(job.bins[i], job.bandHeight, camera, arenas[i], bandCount, hiZTileSize);
+	}
+	job.bandCount = static_cast<unsigned int>(job.bins[0].size());
 
-		// Cleanup the shadow maps
+	// A hierarchical z-buffer for each map, to skip the polygons that are hidden from the light (if asked for, see TMap.h)
 
+	if (shadowMapHiZ())
+	{
+		job.hiZs.resize(lights.size());
 		for (unsigned int i = 0; i < lights.size(); ++i)
 		{
-			delete[] shadowMaps[i].zBuffer;
+			const ShadowMap &	map = shadowMaps[job.firstMap + i];
+			createHiZ(job.hiZs[i], map.zBuffer, map.camera.width, map.camera.height);
 		}
-		shadowMaps.clear();
 	}
 
-	printf("write...");
+	threads.run(job, static_cast<unsigned int>(lights.size()) * job.bandCount);
+
+	for (unsigned int i = 0; i < job.hiZs.size(); ++i) destroyHiZ(job.hiZs[i]);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Vertex welding: hashes a vertex's position (the bits of its coordinates, or the cell of the tolerance-sized grid it falls in)
+
+static	const	unsigned int	noVertex = 0xffffffff;
+
+static	inline	unsigned int	weldHash(const unsigned int x, const unsigned int y, const unsigned int z)
+{
+	unsigned int	h = x * 73856093 ^ y * 19349663 ^ z * 83492791;
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return h;
+}
+
+static	inline	unsigned int	weldBits(const float f)
+{
+	// -0 and 0 are the same position
+
+	if (f == 0) return 0;
+
+	unsigned int	bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static	inline	int	weldCell(const float f, const float cellScale)
+{
+	// Far away cells are lumped together (the vertices are always compared, so this only costs time)
+
+	const	float	limit = static_cast<float>(1 << 30);
+	float	cell = floorf(f * cellScale);
+	if (cell < -limit) cell = -limit;
+	if (cell >  limit) cell =  limit;
+	return static_cast<int>(cell);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Welds the vertices of a mesh: every face is switched over to the first vertex (in the mesh's order) at the same position as each
+// of its vertices -- or with a tolerance, the first one within the tolerance of it. Only the faces change, the unused vertices are
+// simply left alone. Returns the number of vertices welded.
+//
+// Only the vertices that are kept are added to the hash table, so each position is only ever found once. With a tolerance, the
+// vertices are hashed by grid cell (the size of the tolerance) and the 27 cells around a vertex are searched.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	unsigned int	weldMesh(sMSH & mesh, const float tolerance)
+{
+	const	unsigned int	vCount = mesh.vCount;
+	if (!vCount) return 0;
+
+	unsigned int	bucketCount = 1;
+	while (bucketCount < vCount * 2) bucketCount <<= 1;
+	const	unsigned int	bucketMask = bucketCount - 1;
+
+	std::vector<unsigned int>	buckets(bucketCount, noVertex);	// First vertex in each bucket
+	std::vector<unsigned int>	chain(vCount);			// Next vertex in the same bucket
+	std::vector<unsigned int>	remap(vCount);			// The vertex that each vertex is welded to
+
+	const	sP3D *	verts = mesh.vList;
+	float		cellScale = tolerance > 0 ? 1.0f / tolerance : 0;
+	unsigned int	weldedCount = 0;
+
+	for (unsigned int j = 0; j < vCount; ++j)
 	{
-		image.write(imageFilename);
+		const sP3D &	v = verts[j];
+		unsigned int	match = noVertex;
+		unsigned int	bucket;
+
+		if (tolerance > 0)
+		{
+			int	cx = weldCell(v.x, cellScale);
+			int	cy = weldCell(v.y, cellScale);
+			int	cz = weldCell(v.z, cellScale);
+
+			for (int dz = -1; dz <= 1; ++dz)
+			for (int dy = -1; dy <= 1; ++dy)
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				unsigned int	k = buckets[weldHash(cx + dx, cy + dy, cz + dz) & bucketMask];
+				for (; k != noVertex; k = chain[k])
+				{
+					const sP3D &	w = verts[k];
+					if (k < match && fabsf(w.x - v.x) <= tolerance && fabsf(w.y - v.y) <= tolerance && fabsf(w.z - v.z) <= tolerance) match = k;
+				}
+			}
+
+			bucket = weldHash(cx, cy, cz) & bucketMask;
+		}
+		else
+		{
+			bucket = weldHash(weldBits(v.x), weldBits(v.y), weldBits(v.z)) & bucketMask;
+			for (unsigned int k = buckets[bucket]; k != noVertex; k = chain[k])
+			{
+				const sP3D &	w = verts[k];
+				if (w.x == v.x && w.y == v.y && w.z == v.z) {match = k; break;}
+			}
+		}
+
+		// A duplicate, or the first of its kind?
+
+		if (match != noVertex)
+		{
+			remap[j] = match;
+			++weldedCount;
+		}
+		else
+		{
+			remap[j] = j;
+			chain[j] = buckets[bucket];
+			buckets[bucket] = j;
+		}
 	}
 
-	printf("done.\n");
+	// Switch the faces over to the welded vertices
+
+	if (weldedCount)
 	{
+		for (unsigned int j = 0; j < mesh.fCount; ++j)
+		{
+			sFACE &	face = mesh.fList[j];
+			if (face.a < vCount) face.a = static_cast<unsigned short>(remap[face.a]);
+			if (face.b < vCount) face.b = static_cast<unsigned short>(remap[face.b]);
+			if (face.c < vCount) face.c = static_cast<unsigned short>(remap[face.c]);
+		}
 	}
+
+	return weldedCount;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-void	Render::importScene(const std::string & filename, std::vector<primitive<> > & primitives, std::vector<sLIGHT> & lights, Point4 & cameraPosition, Vector3 & cameraDirection, float & cameraBank, float & cameraFOV)
+void	Render::importScene(const std::string & filename, const sWELD & weld, std::vector<primitive<> > & primitives, std::vector<sMESH> & meshes, std::vector<sLIGHT> & lights, Point4 & cameraPosition, Vector3 & cameraDirection, float & cameraBank, float & cameraFOV, Stats * stats)
 {
 	// Load the 3DS scene file
 
@@ -194,6 +503,8 @@ void	Render::importScene(const std::string & filename, std::vector<primitive<> >
 
 	// Convert the primitives
 
+	unsigned int	weldedCount = 0;
+
 	for (unsigned int i = 0; i < info.meshCount; i++)
 	{
 		// Our current mesh
@@ -201,35 +512,8 @@ void	Render::importScene(const std::string & filename, std::vector<primitive<> >
 		sMSH	&mesh = info.mesh[i];
 
 		// Weld vertices... it seems that max doesn't always do this for some objects
-		{
-			sP3D *	verts = mesh.vList;
-			sFACE *	faces = mesh.fList;
-			for (unsigned int j = 0; j < mesh.vCount; ++j)
-			{
-				sP3D &	jVert = verts[j];
-				for (unsigned int k = j+1; k < mesh.vCount; ++k)
-				{
-					if (jVert.x == verts[k].x && jVert.y == verts[k].y && jVert.z == verts[k].z)
-					{
-						// 'k' is a duplicate. Locate all faces using 'k' and switch them over to use 'j'
-
-						for (unsigned int l = 0; l < mesh.fCount; ++l)
-						{
-							sFACE &	face = faces[l];
-							if (face.a == k) face.a = j;
-							if (face.b == k) face.b = j;
-							if (face.c == k) face.c = j;
-						}
-
-						// Wipe out 'k' so we don't hit it again
-
-						verts[k].x = -123;
-						verts[k].y = -456;
-						verts[k].z = -789;
-					}
-				}
-			}
-		}
+
+		if (weld.enabled) weldedCount += weldMesh(mesh, weld.tolerance);
 
 		// We'll be putting stuff in these...
 
@@ -304,6 +588,25 @@ void	Render::importScene(const std::string & filename, std::vector<primitive<> >
 			p[1].normal() = Vector3(b.x, b.y, b.z);	p[1].normal().normalize();
 			p[2].normal() = Vector3(c.x, c.y, c.z);	p[2].normal().normalize();
 		}
+
+		// Keep track of the mesh (as the primitives it became)
+
+		sMESH	m;
+		m.start = static_cast<unsigned int>(startPolyIndex);
+		m.count = static_cast<unsigned int>(primitives.size()) - m.start;
+		if (!m.count) continue;
+
+		calcMeshBounds(m, primitives);
+		meshes.push_back(m);
+	}
+
+	if (stats) stats->verticesWelded() += weldedCount;
+
+	// Save the welded scene (the faces are all that changed)
+
+	if (weld.enabled && weld.saveFilename.length())
+	{
+		loader.saveFaceLists(filename.c_str(), weld.saveFilename.c_str(), &info);
 	}
 
 	// Generate a useful camera
@@ -432,20 +735,124 @@ void	Render::importScene(const std::string & filename, std::vector<primitive<> >
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-sVERT *	Render::transformAndClip(const Camera & camera, const Matrix4 & xform, const Jpeg & texture, std::vector<primitive<> > & primitives, unsigned int & renderPolygonCount)
+void	Render::calcMeshBounds(sMESH & mesh, const std::vector<primitive<> > & primitives)
 {
-	// Transform the geometry
+	// The box
 
-	for (unsigned int i = 0; i < primitives.size(); i++)
+	mesh.minimum = mesh.maximum = Point3(0, 0, 0);
+	bool	first = true;
+	for (unsigned int i = mesh.start; i < mesh.start + mesh.count; ++i)
 	{
-		primitive<> &	p = primitives[i];
-		for (unsigned int j = 0; j < p.vertexCount(); j++)
+		const primitive<> &	p = primitives[i];
+		for (unsigned int j = 0; j < p.vertexCount(); ++j, first = false)
 		{
-			p[j].xform(xform);
+			const Point4 &	v = p[j].world();
+			if (first || v.x() < mesh.minimum.x()) mesh.minimum.x() = v.x();
+			if (first || v.y() < mesh.minimum.y()) mesh.minimum.y() = v.y();
+			if (first || v.z() < mesh.minimum.z()) mesh.minimum.z() = v.z();
+			if (first || v.x() > mesh.maximum.x()) mesh.maximum.x() = v.x();
+			if (first || v.y() > mesh.maximum.y()) mesh.maximum.y() = v.y();
+			if (first || v.z() > mesh.maximum.z()) mesh.maximum.z() = v.z();
 		}
-		p.calcViewPlane(false);
 	}
 
+	// The sphere -- just big enough to hold every vertex, which is usually a good bit smaller than one around the box
+
+	mesh.center = (mesh.minimum + mesh.maximum) * 0.5f;
+	float	radius2 = 0;
+	for (unsigned int i = mesh.start; i < mesh.start + mesh.count; ++i)
+	{
+		const primitive<> &	p = primitives[i];
+		for (unsigned int j = 0; j < p.vertexCount(); ++j)
+		{
+			const Point4 &	v = p[j].world();
+			Vector3		d(v.x() - mesh.center.x(), v.y() - mesh.center.y(), v.z() - mesh.center.z());
+			float		dist2 = d ^ d;
+			if (dist2 > radius2) radius2 = dist2;
+		}
+	}
+	mesh.radius = sqrtf(radius2);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::cullPrimitives(std::vector<unsigned int> & order, const Camera & camera, const Matrix4 & xform, const unsigned int primitiveCount, const std::vector<sMESH> & meshes, const Bvh * bvh, const float range, Stats * stats)
+{
+	order.clear();
+
+	Point3		eye(camera.position.x(), camera.position.y(), camera.position.z());
+	sCULLCOUNT	count = {0, 0, 0};
+
+	// The BVH does it all in one go
+
+	if (bvh && !bvh->empty() && bvhCulling())
+	{
+		order.reserve(primitiveCount);
+		bvh->cull(order, xform, eye, camera.direction, range, count);
+
+		if (stats)
+		{
+			stats->bvhNodesTested() += count.tested;
+			stats->bvhNodesCulled() += count.culled;
+			stats->polygonsBvhCulled() += count.polygons;
+		}
+		return;
+	}
+
+	// Cull the meshes that are entirely off-screen (or out of range) and sort the rest front-to-back by the view depth of their
+	// centers. Sorting by the nearest point of each bounding sphere was tried first, and it was worse: a large mesh (a floor or a
+	// wall) sorts ahead of the smaller meshes in front of it. The polygons within each mesh keep their order.
+
+	std::vector<std::pair<float, unsigned int> >	byDepth;
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		const sMESH &	mesh = meshes[i];
+		bool		inside;
+		if (boundsOutside(mesh.minimum, mesh.maximum, xform, inside) || (range > 0 && boundsBeyond(mesh.minimum, mesh.maximum, eye, range)))
+		{
+			++count.culled;
+			count.polygons += mesh.count;
+			continue;
+		}
+
+		Vector3	toCenter(mesh.center - eye);
+		byDepth.push_back(std::make_pair(toCenter ^ camera.direction, i));
+	}
+	std::sort(byDepth.begin(), byDepth.end());
+
+	// With no meshes, that's everything
+
+	if (meshes.empty())
+	{
+		order.resize(primitiveCount);
+		for (unsigned int i = 0; i < primitiveCount; ++i) order[i] = i;
+	}
+
+	for (unsigned int i = 0; i < byDepth.size(); ++i)
+	{
+		const sMESH &	mesh = meshes[byDepth[i].second];
+		for (unsigned int j = mesh.start; j < mesh.start + mesh.count; ++j) order.push_back(j);
+	}
+
+	if (stats)
+	{
+		stats->meshesTested() += meshes.size();
+		stats->meshesCulled() += count.culled;
+		stats->polygonsMeshCulled() += count.polygons;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::transformAndClip(VertexArena & polygons, const Camera & camera, const Matrix4 & xform, const unsigned int textureWidth, const unsigned int textureHeight, const std::vector<primitive<> > & primitives, const std::vector<sMESH> & meshes, const Bvh * bvh, Stats * stats, const float range)
+{
+	unsigned int	culledCount = 0, rejectedCount = 0, clippedCount = 0;
+
+	// What to draw, and in what order
+
+	std::vector<unsigned int>	order;
+	cullPrimitives(order, camera, xform, static_cast<unsigned int>(primitives.size()), meshes, bvh, range, stats);
+
 	// Screen center
 
 	Point2	screenCenter(static_cast<float>(camera.width) / 2.0f, static_cast<float>(camera.height) / 2.0f);
@@ -457,185 +864,863 @@ sVERT *	Render::transformAndClip(const Camera & camera, const Matrix4 & xform, c
 	float	xPixelBorderScalar = (screenCenter.x() - 1) / screenCenter.x();
 	float	yPixelBorderScalar = (screenCenter.y() - 1) / screenCenter.y();
 
-	// Transform, project & clip the polygons into vertex arrays
+	// Transform, project & clip the polygons into the vertex arena
 
-	sVERT *		renderVertices = new sVERT[64 * primitives.size()];
-	renderPolygonCount = 0;
+	polygons.clear();
 
-	for (unsigned int i = 0; i < primitives.size(); i++)
+	for (unsigned int k = 0; k < order.size(); k++)
 	{
-		// Note this is a copy of the primitive, not the actual primitive. This is because we're going to clip it
+		unsigned int		i = order[k];
+		const primitive<> &	p = primitives[i];
+
+		// Transform the vertices straight into the ones that get clipped (the primitives themselves are only read, so they
+		// can be shared by renders running at the same time)
 
-		primitive<>	p = primitives[i];
+		sCLIPVERT	clipVerts[maxClipVertices];
+		unsigned int	vertexCount = p.vertexCount();
+		unsigned int	j;
+		for (j = 0; j < vertexCount; j++)
+		{
+			Vector4	normal = p[j].normal();
+			normal.w() = 0;
+
+			clipVerts[j].world = p[j].world();
+			clipVerts[j].view = xform >> p[j].world();
+			clipVerts[j].texture = p[j].texture();
+			clipVerts[j].normal = xform >> normal;
+		}
 
 		// Backface culling
 
-		if (p[0].normalView().z() >= 0 && p[1].normalView().z() >= 0 && p[2].normalView().z() >= 0) continue;
+		if (clipVerts[0].normal.z() >= 0 && clipVerts[1].normal.z() >= 0 && clipVerts[2].normal.z() >= 0) {++culledCount; continue;}
 
-		// Transform & code the vertices
+		// Code the vertices
 
 		unsigned int	codeOff = (unsigned int) -1;
 		unsigned int	codeOn = 0;
-		unsigned int	j;
-		for (j = 0; j < p.vertexCount(); j++)
+		for (j = 0; j < vertexCount; j++)
 		{
-			// World view
-
-			Point4 &	wv = p[j].worldView();
-
-			unsigned int	code =	(wv.x() >  wv.w() ?  1:0) | (wv.x() < -wv.w() ?  2:0) |
-						(wv.y() >  wv.w() ?  4:0) | (wv.y() < -wv.w() ?  8:0) |
-						(wv.z() <     0.0 ? 16:0) | (wv.z() >  wv.w() ? 32:0);
+			unsigned int	code = clipCode(clipVerts[j].view);
 			codeOff &= code;
 			codeOn  |= code;
 		}
 
 		// Completely coded off-screen?
 
-		if (codeOff) continue;
+		if (codeOff) {++rejectedCount; continue;}
 
-		// Only bother trying to clip if it's partially off-screen
+		// Only bother trying to clip if it's partially off-screen (and then, only against the planes it crosses)
 
-		if (codeOn && !clipPrimitive(p)) continue;
+		if (codeOn)
+		{
+			++clippedCount;
+			vertexCount = clipPolygon(clipVerts, vertexCount, codeOn);
+			if (vertexCount < 3) continue;
+		}
 
 		// Project
 
-		sVERT *		verts = renderVertices + renderPolygonCount * 64;
-		for (j = 0; j < p.vertexCount(); j++)
+		sVERT *		verts = polygons.addPolygon(vertexCount);
+		for (j = 0; j < vertexCount; j++)
 		{
-			vert<> &	v = p[j];
-
-			float	ow = 1.0f / v.worldView().w();
-			verts[j].screen.x() = screenCenter.x() + v.worldView().x() * ow * screenCenter.x() * xPixelBorderScalar;
-			verts[j].screen.y() = screenCenter.y() - v.worldView().y() * ow * screenCenter.y() * yPixelBorderScalar;
-			verts[j].world = v.world() * ow;
-			verts[j].normal = v.normalView() * ow;
-			verts[j].view.x() = v.worldView().x() * ow;
-			verts[j].view.y() = v.worldView().y() * ow;
-			verts[j].view.z() = v.worldView().z() * ow;
+			const sCLIPVERT &	v = clipVerts[j];
+
+			float	ow = 1.0f / v.view.w();
+			verts[j].screen.x() = screenCenter.x() + v.view.x() * ow * screenCenter.x() * xPixelBorderScalar;
+			verts[j].screen.y() = screenCenter.y() - v.view.y() * ow * screenCenter.y() * yPixelBorderScalar;
+			verts[j].world = v.world * ow;
+			verts[j].normal = v.normal * ow;
+			verts[j].view.x() = v.view.x() * ow;
+			verts[j].view.y() = v.view.y() * ow;
+			verts[j].view.z() = v.view.z() * ow;
 			verts[j].view.w() = ow;
-			verts[j].texture.u() = v.textureView().x() * ow * texture.width();
-			verts[j].texture.v() = v.textureView().y() * ow * texture.height();
+			verts[j].texture.u() = v.texture.x() * ow * textureWidth;
+			verts[j].texture.v() = v.texture.y() * ow * textureHeight;
 			verts[j].polygonID = i;
-			verts[j].next = &verts[j+1];
 		}
-		verts[j-1].next = NULL;
-
-		// Count this one
+	}
 
-		++renderPolygonCount;
+	if (stats)
+	{
+		stats->polygonsTransformed() += order.size();
+		stats->polygonsCulled() += culledCount;
+		stats->polygonsRejected() += rejectedCount;
+		stats->polygonsClipped() += clippedCount;
+		stats->polygonsEmitted() += polygons.polygonCount();
 	}
+}
 
-	return renderVertices;
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Copies a polygon's vertices, offset for the current pass, returning the vertex count
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	unsigned int	offsetPolygon(sVERT * offsetVerts, const VertexArena & polygons, const unsigned int polygon, const float xAAOffset, const float yAAOffset)
+{
+	const sVERT *	src = polygons.vertices(polygon);
+	unsigned int	vertexCount = polygons.vertexCount(polygon);
+	for (unsigned int j = 0; j < vertexCount; ++j)
+	{
+		offsetVerts[j] = src[j];
+		offsetVerts[j].screen.x() += xAAOffset;
+		offsetVerts[j].screen.y() += yAAOffset;
+	}
+	return vertexCount;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Renders the oversample passes. Each task renders one band of scanlines of one pass into the frame and z buffers of the thread
+// that runs it, and accumulates the band into that thread's own accumulation buffer. A task only ever touches its own scanlines of
+// its own thread's buffers, so the tasks can be run on any thread and in any order. Since accumulation is a simple integer sum,
+// the result (once the per-thread accumulation buffers are reduced) is exactly the same as rendering the passes one at a time.
+//
+// For adaptive antialiasing, the first pass is rendered by itself into a single set of (shared) buffers, also recording the
+// polygon ID of each pixel. The rest of the passes are then only drawn where the edge mask is set.
+//
+// With a depth pre-pass, each band is drawn twice: first just the depths (noting which polygon is visible at each pixel, in the
+// shared ID buffer or the thread's own) and then the shading, only where each polygon is the visible one.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-void	Render::renderGeometry(Jpeg & image, const Camera & camera, const sPHONG & phong, const sVERT * renderVertices, const unsigned int renderPolygonCount, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const Jpeg & texture)
+class	RenderJob : public ThreadJob
 {
-	// Allocate our accumulation buffer
+public:
+virtual		void		run(const unsigned int task, const unsigned int thread)
+		{
+			// Which pass & band is this?
+
+			unsigned int	pass = firstPass + task / static_cast<unsigned int>(bins.size());
+			unsigned int	band = task % static_cast<unsigned int>(bins.size());
+			float		xAAOffset = static_cast<float>(pass % camera->oversampleX) / static_cast<float>(camera->oversampleX);
+			float		yAAOffset = static_cast<float>(pass / camera->oversampleX) / static_cast<float>(camera->oversampleY);
+
+			int		top = band * bandHeight;
+			int		bottom = top + bandHeight;
+			if (bottom > static_cast<int>(camera->height)) bottom = camera->height;
+			unsigned int	offset = top * camera->width;
+			unsigned int	pixCount = (bottom - top) * camera->width;
+
+			unsigned int *	frameBuffer = frameBuffers[sharedBuffers ? 0 : thread];
+			float *		zBuffer = zBuffers[sharedBuffers ? 0 : thread];
+			int *		ids = idBuffer || !depthPrepass ? idBuffer : visibleBuffers[thread];
+
+			// Clear these out...
 
-	unsigned int *	accumBuffer = new unsigned int[camera.width * camera.height * 3];
-	memset(accumBuffer, 0, camera.width * camera.height * 3 * sizeof(unsigned int));
+			memset(frameBuffer + offset, 0, pixCount * sizeof(unsigned int));
+			memset(zBuffer + offset, 0, pixCount * sizeof(float));
+			if (ids) memset(ids + offset, 0xff, pixCount * sizeof(int));
+			sHIZ *		hiz = hiZs.empty() ? NULL : &hiZs[sharedBuffers ? 0 : thread];
+			if (hiz) clearHiZ(*hiz, top, bottom);
 
-	// Allocate the frame buffer and z-buffer
+			// The depth pre-pass, which leaves the ID of the visible polygon in each pixel
 
-	unsigned int *	frameBuffer = new unsigned int[camera.width * camera.height];
-	float *		zBuffer = new float[camera.width * camera.height];
+			sRASTERCOUNT	prepassCount = {0, 0};
+			const std::vector<unsigned int> &	bin = bins[band];
+			for (unsigned int i = 0; depthPrepass && i < bin.size(); i++)
+			{
+				sVERT		offsetVerts[64];
+				unsigned int	vertexCount = offsetPolygon(offsetVerts, *polygons, bin[i], xAAOffset, yAAOffset);
+				drawShadowMapPolygon(offsetVerts, vertexCount, zBuffer, camera->width, top, bottom, stats ? &prepassCount : NULL, hiz, ids);
+			}
+
+			// Render the pre-transformed polygons that touch this band
+
+			sRASTERCOUNT	count = {0, 0};
+			for (unsigned int i = 0; i < bin.size(); i++)
+			{
+				sVERT		offsetVerts[64];
+				unsigned int	vertexCount = offsetPolygon(offsetVerts, *polygons, bin[i], xAAOffset, yAAOffset);
+
+				// Draw it, accumulating the pixels as they're written (for antialiasing). After a pre-pass, only the visible
+				// polygon's pixels are drawn.
+
+				if (depthPrepass)	drawPerspectiveTexturedPolygon(offsetVerts, vertexCount, *lights, *shadowMaps, *phong, frameBuffer, textureBuffer, zBuffer, camera->width, textureWidth, textureHeight, top, bottom, NULL, mask, stats ? &count : NULL, accumBuffers[thread], &shading, hiz, ids);
+				else			drawPerspectiveTexturedPolygon(offsetVerts, vertexCount, *lights, *shadowMaps, *phong, frameBuffer, textureBuffer, zBuffer, camera->width, textureWidth, textureHeight, top, bottom, idBuffer, mask, stats ? &count : NULL, accumBuffers[thread], &shading, hiz);
+			}
+
+			// Statistics & progress (in passes)
+
+			if (!progress && !stats) return;
+
+			threads->lock();
+			if (stats)
+			{
+				stats->pixelsTested() += count.tested;
+				stats->pixelsShaded() += count.written;
+				stats->prepassPixels() += prepassCount.written;
+			}
+
+			unsigned int	renderCount = firstPass + ++tasksDone / static_cast<unsigned int>(bins.size());
+			if (progress && renderCount > lastRenderCount)
+			{
+				lastRenderCount = renderCount;
+				printf("(%03d of %03d)\b\b\b\b\b\b\b\b\b\b\b\b", renderCount, camera->oversampleX * camera->oversampleY);
+			}
+			threads->unlock();
+		}
+
+	const	Camera *		camera;
+	const	sPHONG *		phong;
+	const	std::vector<sLIGHT> *	lights;
+	const	std::vector<ShadowMap> *	shadowMaps;
+	const	VertexArena *		polygons;
+		ThreadPool *		threads;
+		bool			progress;
+		Stats *			stats;
+		std::vector<std::vector<unsigned int> >	bins;
+		unsigned int		bandHeight;
+		std::vector<unsigned int *>	accumBuffers;
+		std::vector<unsigned int *>	frameBuffers;
+		std::vector<float *>	zBuffers;
+		std::vector<sHIZ>	hiZs;
+		bool			sharedBuffers;
+		bool			depthPrepass;
+		int *			idBuffer;
+		std::vector<int *>	visibleBuffers;
+	const	unsigned char *		mask;
+		unsigned int *		textureBuffer;
+		unsigned int		textureWidth;
+		unsigned int		textureHeight;
+		sSPANSHADING		shading;
+		unsigned int		firstPass;
+		unsigned int		tasksDone;
+		unsigned int		lastRenderCount;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// One level of a tree reduction of the per-thread accumulation buffers: buffer[i] += buffer[i + stride] for every i that is a
+// multiple of (stride * 2). Each pair is split into bands so that even the last level (a single pair) runs in parallel.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	ReduceJob : public ThreadJob
+{
+public:
+virtual		void		run(const unsigned int task, const unsigned int thread)
+		{
+			unsigned int	pair = task / bandCount;
+			unsigned int	band = task % bandCount;
+			unsigned int	start = band * bandSize;
+			unsigned int	end = start + bandSize;
+			if (end > bufferSize) end = bufferSize;
+
+			unsigned int *		dst = (*buffers)[pair * stride * 2] + start;
+			const unsigned int *	src = (*buffers)[pair * stride * 2 + stride] + start;
+			for (unsigned int i = start; i < end; ++i)
+			{
+				*(dst++) += *(src++);
+			}
+		}
+
+		std::vector<unsigned int *> *	buffers;
+		unsigned int		stride;
+		unsigned int		bufferSize;
+		unsigned int		bandCount;
+		unsigned int		bandSize;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::renderGeometry(Jpeg & image, const Camera & camera, const sPHONG & phong, const VertexArena & polygons, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const Jpeg & texture, ThreadPool & threads, const bool adaptive, const bool progress, Stats * stats, const bool depthPrepass)
+{
+	unsigned int	pixCount = camera.width * camera.height;
+	unsigned int	threadCount = threads.threadCount();
+	unsigned int	totalRenders = camera.oversampleX * camera.oversampleY;
+
+	// Allocate a frame buffer, z-buffer and accumulation buffer for each thread
+
+	RenderJob	job;
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		job.accumBuffers.push_back(new unsigned int[pixCount * 3]);
+		job.frameBuffers.push_back(new unsigned int[pixCount]);
+		job.zBuffers.push_back(new float[pixCount]);
+		memset(job.accumBuffers[i], 0, pixCount * 3 * sizeof(unsigned int));
+	}
+
+	// And a hierarchical z-buffer for each z-buffer, to skip the polygons that are hidden
+
+	if (hierarchicalZ())
+	{
+		job.hiZs.resize(threadCount);
+		for (unsigned int i = 0; i < threadCount; ++i) createHiZ(job.hiZs[i], job.zBuffers[i], camera.width, camera.height);
+	}
+
+	// The depth pre-pass needs somewhere to note the visible polygons (adaptive antialiasing's first pass uses its ID buffer)
+
+	job.depthPrepass = depthPrepass;
+	for (unsigned int i = 0; depthPrepass && i < threadCount; ++i) job.visibleBuffers.push_back(new int[pixCount]);
 
 	// Allocate a new texture for use as a 32-bit surface
 
 	unsigned int *	textureBuffer = new unsigned int[texture.width() * texture.height()];
 	convert24To32(textureBuffer, texture.buffer(), texture.width(), texture.height());
 
-	int	renderCount = 1;
-	int	totalRenders = camera.oversampleX * camera.oversampleY;
-	for (unsigned int y = 0; y < camera.oversampleY; ++y)
+	job.camera = &camera;
+	job.phong = &phong;
+	job.lights = &lights;
+	job.shadowMaps = &shadowMaps;
+	job.polygons = &polygons;
+	job.threads = &threads;
+	job.progress = progress;
+	job.stats = stats;
+	job.sharedBuffers = false;
+	job.idBuffer = NULL;
+	job.mask = NULL;
+	job.textureBuffer = textureBuffer;
+	job.textureWidth = texture.width();
+	job.textureHeight = texture.height();
+	job.firstPass = 0;
+	job.tasksDone = 0;
+	job.lastRenderCount = 0;
+
+	// Pick the span shader for these lights once, rather than for every polygon
+
+	setupSpanShading(job.shading, lights, shadowMaps, phong, textureBuffer, texture.width(), texture.height());
+
+	// Adaptive antialiasing renders the first pass by itself, and uses it to find the edges
+
+	unsigned char *	mask = NULL;
+	if (adaptive && totalRenders > 1)
 	{
-		// Our Antialiasing offset in the Y direction
+		// Render the first pass in bands, all into the first thread's buffers
+
+		job.idBuffer = new int[pixCount];
+		job.sharedBuffers = true;
+		binPolygons(job.bins, job.bandHeight, camera, polygons, threadCount > 1 ? threadCount * bandsPerThread : 1, hiZTileSize);
+		threads.run(job, static_cast<unsigned int>(job.bins.size()));
+
+		// Find the edges
+
+		mask = new unsigned char[pixCount];
+		findEdges(mask, job.idBuffer, job.zBuffers[0], camera.width, camera.height);
 
-		float	yAAOffset = static_cast<float>(y) / static_cast<float>(camera.oversampleY);
+		// Pixels that aren't on an edge won't be drawn again, so their first sample stands in for the rest of them
 
-		for (unsigned int x = 0; x < camera.oversampleX; ++x, ++renderCount)
+		const unsigned int *	src = job.frameBuffers[0];
+		unsigned int *		dst = job.accumBuffers[0];
+		for (unsigned int i = 0; i < pixCount; ++i, ++src, dst += 3)
 		{
-			printf("(%03d of %03d)\b\b\b\b\b\b\b\b\b\b\b\b", renderCount, totalRenders);
+			if (mask[i]) continue;
+			dst[0] += ((*src >> 16) & 0xff) * (totalRenders - 1);
+			dst[1] += ((*src >>  8) & 0xff) * (totalRenders - 1);
+			dst[2] += ((*src      ) & 0xff) * (totalRenders - 1);
+		}
+
+		delete[] job.idBuffer;
+		job.idBuffer = NULL;
+		job.sharedBuffers = false;
+		job.mask = mask;
+		job.firstPass = 1;
+		job.tasksDone = 0;
+		job.lastRenderCount = 1;
+	}
+
+	// Render the passes concurrently. If there aren't enough passes to keep all of the threads busy, the passes are also split
+	// into bands (and the polygons binned into them.) A single thread just renders one band (the whole screen) per pass.
 
-			// Our Antialiasing offset in the X direction
+	unsigned int	passCount = totalRenders - job.firstPass;
+	unsigned int	bandCount = 1;
+	if (threadCount > 1) bandCount = (threadCount * bandsPerThread + passCount - 1) / passCount;
+
+	binPolygons(job.bins, job.bandHeight, camera, polygons, bandCount, hiZTileSize);
+	threads.run(job, passCount * static_cast<unsigned int>(job.bins.size()));
+	delete[] mask;
+
+	if (stats)
+	{
+		stats->passes() += totalRenders;
+		stats->pixels() += pixCount * totalRenders;
+	}
 
-			float	xAAOffset = static_cast<float>(x) / static_cast<float>(camera.oversampleX);
+	// Reduce the per-thread accumulation buffers into the first one
+
+	ReduceJob	reduce;
+	reduce.buffers = &job.accumBuffers;
+	reduce.bufferSize = pixCount * 3;
+	for (reduce.stride = 1; reduce.stride < threadCount; reduce.stride *= 2)
+	{
+		unsigned int	pairCount = (threadCount - reduce.stride + reduce.stride * 2 - 1) / (reduce.stride * 2);
+		reduce.bandCount = (threadCount * bandsPerThread + pairCount - 1) / pairCount;
+		reduce.bandSize = (reduce.bufferSize + reduce.bandCount - 1) / reduce.bandCount;
+		threads.run(reduce, pairCount * reduce.bandCount);
+	}
+
+	unsigned int *	accumBuffer = job.accumBuffers[0];
+
+	// Done with these
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		if (i) delete[] job.accumBuffers[i];
+		delete[] job.frameBuffers[i];
+		delete[] job.zBuffers[i];
+	}
+	for (unsigned int i = 0; i < job.hiZs.size(); ++i) destroyHiZ(job.hiZs[i]);
+	for (unsigned int i = 0; i < job.visibleBuffers.size(); ++i) delete[] job.visibleBuffers[i];
+	delete[] textureBuffer;
+
+	// Downsample the accumulation buffer straight into the (24-bit) image
+
+	downsampleTo24(image.buffer(), accumBuffer, camera.width, camera.height, camera.oversampleX, camera.oversampleY);
+
+	// We're officially done with this
+
+	delete[] accumBuffer;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Renders every subsample in a single pass, one band of scanlines per task. Each thread has its own (band-sized) sample & depth
+// buffers, and each band is resolved into its own scanlines of the accumulation buffer as soon as it's done.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	MultisampleJob : public ThreadJob
+{
+public:
+virtual		void		run(const unsigned int task, const unsigned int thread)
+		{
+			int		top = task * bandHeight;
+			int		bottom = top + bandHeight;
+			if (bottom > static_cast<int>(camera->height)) bottom = camera->height;
+			unsigned int	sampleCount = camera->oversampleX * camera->oversampleY;
+			unsigned int	bandSamples = (bottom - top) * camera->width * sampleCount;
+
+			unsigned int *	sampleBuffer = sampleBuffers[thread];
+			float *		zBuffer = zBuffers[thread];
 
 			// Clear these out...
 
-			memset(frameBuffer, 0, camera.width * camera.height * sizeof(unsigned int));
-			memset(zBuffer, 0, camera.width * camera.height * sizeof(float));
+			memset(sampleBuffer, 0, bandSamples * sizeof(unsigned int));
+			memset(zBuffer, 0, bandSamples * sizeof(float));
 
-			// Render the pre-transformed polygons
+			// Render the pre-transformed polygons that touch this band
 
-			for (unsigned int i = 0; i < renderPolygonCount; i++)
+			sRASTERCOUNT	count = {0, 0};
+			const std::vector<unsigned int> &	bin = bins[task];
+			for (unsigned int i = 0; i < bin.size(); i++)
 			{
-				// Build a set of vertices that are offset
+				drawMultisampledPolygon(polygons->vertices(bin[i]), polygons->vertexCount(bin[i]), *lights, *shadowMaps, *phong, sampleBuffer, zBuffer, camera->width, textureBuffer, textureWidth, textureHeight, camera->oversampleX, camera->oversampleY, top, bottom, stats ? &count : NULL);
+			}
 
-				sVERT		offsetVerts[64];
-				const sVERT *	src = renderVertices + i * 64;
-				sVERT *		dst = offsetVerts;
-				for (; src; src = src->next, dst = dst->next)
-				{
-					*dst = *src;
-					dst->screen.x() += xAAOffset;
-					dst->screen.y() += yAAOffset;
-					dst->next = dst+1;
-				}
-				(dst-1)->next = NULL;
+			if (stats)
+			{
+				threads->lock();
+				stats->pixelsTested() += count.tested;
+				stats->pixelsShaded() += count.written;
+				threads->unlock();
+			}
+
+			// Resolve the samples into the accumulation buffer
+
+			Render::resolveSamples(accumBuffer + top * camera->width * 3, sampleBuffer, camera->width, bottom - top, sampleCount);
+		}
+
+	const	Camera *		camera;
+	const	sPHONG *		phong;
+	const	std::vector<sLIGHT> *	lights;
+	const	std::vector<ShadowMap> *	shadowMaps;
+	const	VertexArena *		polygons;
+		ThreadPool *		threads;
+		Stats *			stats;
+		std::vector<std::vector<unsigned int> >	bins;
+		unsigned int		bandHeight;
+		unsigned int *		accumBuffer;
+		std::vector<unsigned int *>	sampleBuffers;
+		std::vector<float *>	zBuffers;
+		unsigned int *		textureBuffer;
+		unsigned int		textureWidth;
+		unsigned int		textureHeight;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::renderGeometryMultisampled(Jpeg & image, const Camera & camera, const sPHONG & phong, const VertexArena & polygons, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const Jpeg & texture, ThreadPool & threads, Stats * stats)
+{
+	unsigned int	pixCount = camera.width * camera.height;
+	unsigned int	threadCount = threads.threadCount();
+	unsigned int	sampleCount = camera.oversampleX * camera.oversampleY;
+
+	// Split the screen into bands -- enough to keep the threads busy, and small enough to keep the sample buffers reasonable
+
+	unsigned int	bandCount = threadCount > 1 ? threadCount * bandsPerThread : 1;
+	unsigned int	maxBandHeight = multisampleBandSamples / (camera.width * sampleCount);
+	if (!maxBandHeight) maxBandHeight = 1;
+	if (bandCount < (camera.height + maxBandHeight - 1) / maxBandHeight) bandCount = (camera.height + maxBandHeight - 1) / maxBandHeight;
+
+	MultisampleJob	job;
+	binPolygons(job.bins, job.bandHeight, camera, polygons, bandCount);
+
+	// Allocate our accumulation buffer
+
+	job.accumBuffer = new unsigned int[pixCount * 3];
+	memset(job.accumBuffer, 0, pixCount * 3 * sizeof(unsigned int));
+
+	// Allocate a (band-sized) sample buffer and z-buffer for each thread
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		job.sampleBuffers.push_back(new unsigned int[job.bandHeight * camera.width * sampleCount]);
+		job.zBuffers.push_back(new float[job.bandHeight * camera.width * sampleCount]);
+	}
+
+	// Allocate a new texture for use as a 32-bit surface
+
+	job.textureBuffer = new unsigned int[texture.width() * texture.height()];
+	convert24To32(job.textureBuffer, texture.buffer(), texture.width(), texture.height());
+
+	// Render the bands
+
+	job.camera = &camera;
+	job.phong = &phong;
+	job.lights = &lights;
+	job.shadowMaps = &shadowMaps;
+	job.polygons = &polygons;
+	job.threads = &threads;
+	job.stats = stats;
+	job.textureWidth = texture.width();
+	job.textureHeight = texture.height();
+	threads.run(job, static_cast<unsigned int>(job.bins.size()));
+
+	// Everything is shaded in a single pass
+
+	if (stats)
+	{
+		stats->passes() += 1;
+		stats->pixels() += pixCount;
+	}
+
+	// Done with these
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		delete[] job.sampleBuffers[i];
+		delete[] job.zBuffers[i];
+	}
+	delete[] job.textureBuffer;
+
+	// Downsample the accumulation buffer straight into the (24-bit) image
+
+	downsampleTo24(image.buffer(), job.accumBuffer, camera.width, camera.height, camera.oversampleX, camera.oversampleY);
+
+	// We're officially done with this
+
+	delete[] job.accumBuffer;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::binPolygons(std::vector<std::vector<unsigned int> > & bins, unsigned int & bandHeight, const Camera & camera, const VertexArena & polygons, const unsigned int bandCount, const unsigned int bandAlignment)
+{
+	// The bands are a multiple of bandAlignment scanlines high (hierarchical z-buffer tiles can't be split between bands)
+
+	bandHeight = (camera.height + bandCount - 1) / bandCount;
+	bandHeight = (bandHeight + bandAlignment - 1) / bandAlignment * bandAlignment;
+	if (!bandHeight) bandHeight = 1;
+
+	bins.clear();
+	bins.resize((camera.height + bandHeight - 1) / bandHeight);
+
+	for (unsigned int i = 0; i < polygons.polygonCount(); i++)
+	{
+		// Vertical extent of the polygon
+
+		const sVERT *	v = polygons.vertices(i);
+		float		minY = v[0].screen.y();
+		float		maxY = v[0].screen.y();
+		for (unsigned int j = 1; j < polygons.vertexCount(i); ++j)
+		{
+			if (v[j].screen.y() < minY) minY = v[j].screen.y();
+			if (v[j].screen.y() > maxY) maxY = v[j].screen.y();
+		}
+
+		// The antialiasing offsets are in [0, 1) so the polygon can only ever cover scanlines [ceil(minY), ceil(maxY)]
+
+		int	first = static_cast<int>(ceil(minY)) / static_cast<int>(bandHeight);
+		int	last = static_cast<int>(ceil(maxY)) / static_cast<int>(bandHeight);
+		if (first < 0) first = 0;
+		if (last >= static_cast<int>(bins.size())) last = static_cast<int>(bins.size()) - 1;
+
+		// The polygons stay in their original order within each bin, since the order matters when depths are equal
+
+		for (int j = first; j <= last; ++j) bins[j].push_back(i);
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Lights the oversample passes into the G-buffer. Each task lights one band of scanlines of one pass into that pass's own plane of
+// the G-buffer, with the z-buffer of the thread that runs it. Like RenderJob, the polygons are drawn in their original order within
+// each band, so the G-buffer is exactly the same regardless of the number of threads.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	GBufferJob : public ThreadJob
+{
+public:
+virtual		void		run(const unsigned int task, const unsigned int thread)
+		{
+			// Which pass & band is this?
+
+			unsigned int	pass = task / static_cast<unsigned int>(bins.size());
+			unsigned int	band = task % static_cast<unsigned int>(bins.size());
+			float		xAAOffset = static_cast<float>(pass % camera->oversampleX) / static_cast<float>(camera->oversampleX);
+			float		yAAOffset = static_cast<float>(pass / camera->oversampleX) / static_cast<float>(camera->oversampleY);
+
+			int		top = band * bandHeight;
+			int		bottom = top + bandHeight;
+			if (bottom > static_cast<int>(camera->height)) bottom = camera->height;
+			unsigned int	pixCount = camera->width * camera->height;
 
-				// Draw it
+			// Clear this out...
 
-				drawPerspectiveTexturedPolygon(offsetVerts, lights, shadowMaps, phong, frameBuffer, textureBuffer, zBuffer, camera.width, texture.width(), texture.height());
+			float *		zBuffer = zBuffers[thread];
+			memset(zBuffer + top * camera->width, 0, (bottom - top) * camera->width * sizeof(float));
+
+			// Light the pre-transformed polygons that touch this band
+
+			sRASTERCOUNT	count = {0, 0};
+			const std::vector<unsigned int> &	bin = bins[band];
+			for (unsigned int i = 0; i < bin.size(); i++)
+			{
+				sVERT		offsetVerts[64];
+				unsigned int	vertexCount = offsetPolygon(offsetVerts, *polygons, bin[i], xAAOffset, yAAOffset);
+				drawGBufferPolygon(offsetVerts, vertexCount, *lights, *shadowMaps, *phong, samples + pass * pixCount, zBuffer, camera->width, top, bottom, stats ? &count : NULL);
 			}
 
-			// Accumulate the results for antialiasing
+			// Statistics & progress (in passes)
+
+			if (!progress && !stats) return;
+
+			threads->lock();
+			if (stats)
+			{
+				stats->pixelsTested() += count.tested;
+				stats->pixelsShaded() += count.written;
+			}
 
-			accumulateBuffer(accumBuffer, frameBuffer, camera.width, camera.height);
+			unsigned int	renderCount = ++tasksDone / static_cast<unsigned int>(bins.size());
+			if (progress && renderCount > lastRenderCount)
+			{
+				lastRenderCount = renderCount;
+				printf("(%03d of %03d)\b\b\b\b\b\b\b\b\b\b\b\b", renderCount, camera->oversampleX * camera->oversampleY);
+			}
+			threads->unlock();
 		}
+
+	const	Camera *		camera;
+	const	sPHONG *		phong;
+	const	std::vector<sLIGHT> *	lights;
+	const	std::vector<ShadowMap> *	shadowMaps;
+	const	VertexArena *		polygons;
+		ThreadPool *		threads;
+		bool			progress;
+		Stats *			stats;
+		std::vector<std::vector<unsigned int> >	bins;
+		unsigned int		bandHeight;
+		std::vector<float *>	zBuffers;
+		sGSAMPLE *		samples;
+		unsigned int		tasksDone;
+		unsigned int		lastRenderCount;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::renderGBuffer(GBuffer & gBuffer, const sPHONG & phong, const VertexArena & polygons, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, ThreadPool & threads, const bool progress, Stats * stats)
+{
+	const Camera &	camera = gBuffer.camera;
+	unsigned int	pixCount = camera.width * camera.height;
+	unsigned int	threadCount = threads.threadCount();
+	unsigned int	totalRenders = camera.oversampleX * camera.oversampleY;
+
+	// Allocate the G-buffer -- one full-frame plane for each oversample render, cleared to samples that shade to black
+
+	sGSAMPLE	empty;
+	empty.texture = Point2(0, 0);
+	empty.diffuseScale = Point3(0, 0, 0);
+	empty.specularTerm = Point3(0, 0, 0);
+
+	delete[] gBuffer.samples;
+	gBuffer.samples = new sGSAMPLE[pixCount * totalRenders];
+	std::fill(gBuffer.samples, gBuffer.samples + pixCount * totalRenders, empty);
+
+	// Allocate a z-buffer for each thread
+
+	GBufferJob	job;
+	for (unsigned int i = 0; i < threadCount; ++i) job.zBuffers.push_back(new float[pixCount]);
+
+	job.camera = &camera;
+	job.phong = &phong;
+	job.lights = &lights;
+	job.shadowMaps = &shadowMaps;
+	job.polygons = &polygons;
+	job.threads = &threads;
+	job.progress = progress;
+	job.stats = stats;
+	job.samples = gBuffer.samples;
+	job.tasksDone = 0;
+	job.lastRenderCount = 0;
+
+	// Light the passes concurrently, split into bands if there aren't enough passes to keep all of the threads busy (just as
+	// renderGeometry() does)
+
+	unsigned int	bandCount = 1;
+	if (threadCount > 1) bandCount = (threadCount * bandsPerThread + totalRenders - 1) / totalRenders;
+
+	binPolygons(job.bins, job.bandHeight, camera, polygons, bandCount);
+	threads.run(job, totalRenders * static_cast<unsigned int>(job.bins.size()));
+
+	if (stats)
+	{
+		stats->passes() += totalRenders;
+		stats->pixels() += pixCount * totalRenders;
 	}
 
 	// Done with these
 
-	delete[] zBuffer;
-	delete[] textureBuffer;
+	for (unsigned int i = 0; i < threadCount; ++i) delete[] job.zBuffers[i];
+}
 
-	// Downsample the accumulation buffer into a single standard 32-bit image buffer
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Applies a texture to the G-buffer. Each task shades one band of scanlines through every oversample plane, accumulating them into
+// the band-sized accumulation buffer of the thread that runs it, and then downsamples the band straight into its scanlines of the
+// image. The bands don't share anything, so the image is the same regardless of the number of threads.
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-	downsample(accumBuffer, camera.width, camera.height, camera.oversampleX, camera.oversampleY);
+class	ShadeGBufferJob : public ThreadJob
+{
+public:
+virtual		void		run(const unsigned int task, const unsigned int thread)
+		{
+			const Camera &	camera = gBuffer->camera;
+			unsigned int	top = task * bandHeight;
+			unsigned int	bottom = top + bandHeight;
+			if (bottom > camera.height) bottom = camera.height;
+			unsigned int	offset = top * camera.width;
+			unsigned int	pixCount = (bottom - top) * camera.width;
 
-	// Create an RGB Jpeg image from the 32-bit rendered image stored in the frameBuffer
+			unsigned int *	accumBuffer = accumBuffers[thread];
+			memset(accumBuffer, 0, pixCount * 3 * sizeof(unsigned int));
 
-	convert32To24(image.buffer(), accumBuffer, camera.width, camera.height);
+			// Texture this band of each oversample plane, accumulating the results as we go
 
-	// We're officially done with this
+			unsigned int	totalRenders = camera.oversampleX * camera.oversampleY;
+			for (unsigned int i = 0; i < totalRenders; ++i)
+			{
+				const sGSAMPLE *	src = gBuffer->samples + i * camera.width * camera.height + offset;
+				unsigned int *		dst = accumBuffer;
+				for (unsigned int j = 0; j < pixCount; ++j, ++src)
+				{
+					// The texture coordinates are normalized, so they only need wrapping once in a while
+
+					unsigned int	s = (int) (src->texture.x() * textureWidth);
+					unsigned int	t = (int) (src->texture.y() * textureHeight);
+					if (s >= textureWidth) s %= textureWidth;
+					if (t >= textureHeight) t %= textureHeight;
+
+					int	c = textureBuffer[t * textureWidth + s];
+					int	r = static_cast<int>(((c >> 16) & 0xff) * src->diffuseScale.r() + src->specularTerm.r() * 255);
+					int	g = static_cast<int>(((c >>  8) & 0xff) * src->diffuseScale.g() + src->specularTerm.g() * 255);
+					int	b = static_cast<int>(((c      ) & 0xff) * src->diffuseScale.b() + src->specularTerm.b() * 255);
+					if (r < 0) r = 0;
+					if (r > 255) r = 255;
+					if (g < 0) g = 0;
+					if (g > 255) g = 255;
+					if (b < 0) b = 0;
+					if (b > 255) b = 255;
+
+					*(dst++) += r;
+					*(dst++) += g;
+					*(dst++) += b;
+				}
+			}
 
-	delete[] accumBuffer;
-}
+			// Downsample the band straight into its scanlines of the (24-bit) image
+
+			Render::downsampleTo24(image + offset * 3, accumBuffer, camera.width, bottom - top, camera.oversampleX, camera.oversampleY);
+		}
+
+	const	GBuffer *		gBuffer;
+	const	unsigned int *		textureBuffer;
+		unsigned int		textureWidth;
+		unsigned int		textureHeight;
+		unsigned char *		image;
+		unsigned int		bandHeight;
+		std::vector<unsigned int *>	accumBuffers;
+};
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-void	Render::renderShadowMap(ShadowMap & map, const Camera & camera, sVERT * renderVertices, const unsigned int renderPolygonCount)
+void	Render::shadeGBuffer(Jpeg & image, const GBuffer & gBuffer, const Jpeg & texture, ThreadPool & threads)
 {
-	// Allocate the z-buffer
+	const Camera &	camera = gBuffer.camera;
+	unsigned int	threadCount = threads.threadCount();
+
+	// Allocate a new texture for use as a 32-bit surface
+
+	unsigned int *	textureBuffer = new unsigned int[texture.width() * texture.height()];
+	convert24To32(textureBuffer, texture.buffer(), texture.width(), texture.height());
 
-	memset(map.zBuffer, 0, camera.width * camera.height * sizeof(float));
+	// A single thread shades the whole screen in one go, otherwise it's split into bands (each thread accumulating a band at a
+	// time into its own buffer)
 
-	// Render the pre-transformed polygons
+	unsigned int	bandCount = threadCount > 1 ? threadCount * bandsPerThread : 1;
+	if (bandCount > camera.height) bandCount = camera.height;
 
-	for (unsigned int i = 0; i < renderPolygonCount; i++)
+	ShadeGBufferJob	job;
+	job.gBuffer = &gBuffer;
+	job.textureBuffer = textureBuffer;
+	job.textureWidth = texture.width();
+	job.textureHeight = texture.height();
+	job.image = image.buffer();
+	job.bandHeight = (camera.height + bandCount - 1) / bandCount;
+	bandCount = (camera.height + job.bandHeight - 1) / job.bandHeight;
+	for (unsigned int i = 0; i < threadCount; ++i) job.accumBuffers.push_back(new unsigned int[job.bandHeight * camera.width * 3]);
+
+	threads.run(job, bandCount);
+
+	// Done with these
+
+	for (unsigned int i = 0; i < threadCount; ++i) delete[] job.accumBuffers[i];
+	delete[] textureBuffer;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+unsigned int	Render::findEdges(unsigned char * mask, const int * idBuffer, const float * zBuffer, const unsigned int width, const unsigned int height)
+{
+	unsigned int	edgeCount = 0;
+	for (unsigned int y = 0; y < height; ++y)
 	{
-		// Build a set of vertices that are offset
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			unsigned int	index = y * width + x;
+			int		id = idBuffer[index];
+			float		w = zBuffer[index];
+			bool		edge = false;
+
+			// Check the 8 neighbors. Different polygons only make an edge if one of them is the background, or if there's a
+			// discontinuity in depth (neighboring polygons of a smooth mesh don't.)
 
-		sVERT *	verts = renderVertices + i * 64;
+			for (int dy = -1; dy <= 1 && !edge; ++dy)
+			{
+				int	ny = static_cast<int>(y) + dy;
+				if (ny < 0 || ny >= static_cast<int>(height)) continue;
+
+				for (int dx = -1; dx <= 1 && !edge; ++dx)
+				{
+					int	nx = static_cast<int>(x) + dx;
+					if (nx < 0 || nx >= static_cast<int>(width)) continue;
 
-		// Draw it
+					unsigned int	nIndex = ny * width + nx;
+					if (idBuffer[nIndex] == id) continue;
+					if (id < 0 || idBuffer[nIndex] < 0) {edge = true; continue;}
 
-		drawShadowMapPolygon(verts, map.zBuffer, camera.width);
+					float	nw = zBuffer[nIndex];
+					if (fabs(w - nw) > adaptiveDepthThreshold * (w > nw ? w : nw)) edge = true;
+				}
+			}
+
+			mask[index] = edge ? 1 : 0;
+			if (edge) ++edgeCount;
+		}
 	}
+
+	return edgeCount;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -643,6 +1728,14 @@ void	Render::renderShadowMap(ShadowMap & map, const Camera & camera, sVERT * ren
 void	Render::convert32To24(unsigned char * dest, const unsigned int * source, const unsigned int width, const unsigned int height)
 {
 	unsigned int		pixCount = width * height;
+
+	switch(pixelRoutines())
+	{
+		case SPAN_AVX2:	convert32To24AVX2(dest, source, pixCount); return;
+		case SPAN_SSE2:	convert32To24SSE2(dest, source, pixCount); return;
+		default:	break;
+	}
+
 	const unsigned int *	src = source;
 	unsigned char *		dst = dest;
 
@@ -660,6 +1753,14 @@ void	Render::convert32To24(unsigned char * dest, const unsigned int * source, co
 void	Render::convert24To32(unsigned int * dest, const unsigned char * source, const unsigned int width, const unsigned int height)
 {
 	unsigned int		pixCount = width * height;
+
+	switch(pixelRoutines())
+	{
+		case SPAN_AVX2:	convert24To32AVX2(dest, source, pixCount); return;
+		case SPAN_SSE2:	convert24To32SSE2(dest, source, pixCount); return;
+		default:	break;
+	}
+
 	const unsigned char *	src = source;
 	unsigned int *		dst = dest;
 
@@ -674,6 +1775,14 @@ void	Render::convert24To32(unsigned int * dest, const unsigned char * source, co
 void	Render::accumulateBuffer(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int width, const unsigned int height)
 {
 	unsigned int		pixCount = width * height;
+
+	switch(pixelRoutines())
+	{
+		case SPAN_AVX2:	accumulateBufferAVX2(accumBuffer, frameBuffer, pixCount); return;
+		case SPAN_SSE2:	accumulateBufferSSE2(accumBuffer, frameBuffer, pixCount); return;
+		default:	break;
+	}
+
 	unsigned int *		dst = accumBuffer;
 	const unsigned int *	src = frameBuffer;
 	for (unsigned int i = 0; i < pixCount; ++i, ++src)
@@ -687,10 +1796,41 @@ void	Render::accumulateBuffer(unsigned int * accumBuffer, const unsigned int * f
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+void	Render::resolveSamples(unsigned int * accumBuffer, const unsigned int * sampleBuffer, const unsigned int width, const unsigned int height, const unsigned int sampleCount)
+{
+	unsigned int		pixCount = width * height;
+	unsigned int *		dst = accumBuffer;
+	const unsigned int *	src = sampleBuffer;
+	for (unsigned int i = 0; i < pixCount; ++i)
+	{
+		unsigned int	r = 0, g = 0, b = 0;
+		for (unsigned int j = 0; j < sampleCount; ++j, ++src)
+		{
+			const unsigned int &	pix = *src;
+			r += (pix>>16) & 0xff;
+			g += (pix>> 8) & 0xff;
+			b += (pix    ) & 0xff;
+		}
+		*(dst++) += r;
+		*(dst++) += g;
+		*(dst++) += b;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
 void	Render::downsample(unsigned int * buffer, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY)
 {
 	unsigned int		pixCount = width * height;
 	unsigned int		totalSamples = oversampleX * oversampleY;
+
+	switch(pixelRoutines())
+	{
+		case SPAN_AVX2:	downsampleAVX2(buffer, pixCount, totalSamples); return;
+		case SPAN_SSE2:	downsampleSSE2(buffer, pixCount, totalSamples); return;
+		default:	break;
+	}
+
 	const unsigned int *	src = buffer;
 	unsigned int *		dst = buffer;
 
@@ -703,6 +1843,31 @@ void	Render::downsample(unsigned int * buffer, const unsigned int width, const u
 	}
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Render::downsampleTo24(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY)
+{
+	unsigned int		pixCount = width * height;
+	unsigned int		totalSamples = oversampleX * oversampleY;
+
+	switch(pixelRoutines())
+	{
+		case SPAN_AVX2:	downsampleTo24AVX2(dest, accumBuffer, pixCount, totalSamples); return;
+		case SPAN_SSE2:	downsampleTo24SSE2(dest, accumBuffer, pixCount, totalSamples); return;
+		default:	break;
+	}
+
+	const unsigned int *	src = accumBuffer;
+	unsigned char *		dst = dest;
+
+	for (unsigned int i = 0; i < pixCount; ++i, dst += 3)
+	{
+		dst[0] = static_cast<unsigned char>(*(src++) / totalSamples);
+		dst[1] = static_cast<unsigned char>(*(src++) / totalSamples);
+		dst[2] = static_cast<unsigned char>(*(src++) / totalSamples);
+	}
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Render.cpp - End of file
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -38,8 +38,12 @@
 
 #include "primitive.h"
 #include "tmap.h"
+#include "thread.h"
+#include "bvh.h"
 
 class	Jpeg;
+class	Scene;
+class	Stats;
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
@@ -67,14 +71,100 @@ public:
 	unsigned int	oversampleY;
 };
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A light's shadow map. With ray traced shadows, there's no z-buffer: the shadows are found by tracing a ray through the scene's BVH
+// to the light instead (see lightTerms() in TMap.cpp.) The camera and transform are still set, so a light reaches the same part of
+// the scene either way.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 class	ShadowMap
 {
 public:
+			ShadowMap() : zBuffer(NULL), bvh(NULL) {}
+
 	Camera		camera;
 	Matrix4		xform;
 	float *		zBuffer;
+	const Bvh *	bvh;		// Only for ray traced shadows
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	GBuffer
+{
+public:
+	Camera		camera;
+	sGSAMPLE *	samples;	// One full-frame plane of samples per oversample render
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Vertex welding options for Render::importScene()
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	bool		enabled;	// Weld the coincident vertices of each mesh
+	float		tolerance;	// Weld vertices within this distance of each other (on every axis.) 0 only welds identical ones.
+	std::string	saveFilename;	// If set, a copy of the scene file with the welded meshes is saved here
+} sWELD;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A mesh from the scene file. Render::importScene() flattens the meshes into a single list of primitives, so a mesh is just the
+// range of primitives it became, along with its bounds (for culling whole meshes at a time.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	unsigned int	start;		// Index of the mesh's first primitive
+	unsigned int	count;		// Number of primitives
+	Point3		minimum;	// Bounding box
+	Point3		maximum;
+	Point3		center;		// Bounding sphere (centered on the box)
+	float		radius;
+} sMESH;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The polygons produced by Render::transformAndClip(), ready for the rasterizers. The vertices of every polygon are packed back to
+// back in a single array, and each polygon is just a range of it. Clearing the arena keeps its memory, so an arena that's reused
+// from one render to the next stops allocating once it's big enough.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	unsigned int	start;		// Index of the polygon's first vertex
+	unsigned int	count;		// Number of vertices
+} sPOLYGON;
+
+class	VertexArena
+{
+public:
+	// Operators
+
+inline		void		clear()					{_vertices.clear(); _polygons.clear();}
+
+	// Adds a polygon, returning its (uninitialized) vertices. This invalidates the vertices of any other polygon previously
+	// returned, since the vertices may move.
+
+inline		sVERT *		addPolygon(const unsigned int vertexCount)
+				{
+					sPOLYGON	polygon = {static_cast<unsigned int>(_vertices.size()), vertexCount};
+					_polygons.push_back(polygon);
+					_vertices.resize(polygon.start + vertexCount);
+					return &_vertices[polygon.start];
+				}
+
+	// Accessors
+
+inline		unsigned int	polygonCount() const			{return static_cast<unsigned int>(_polygons.size());}
+inline		unsigned int	vertexCount(const unsigned int i) const	{return _polygons[i].count;}
+inline		sVERT *		vertices(const unsigned int i)		{return &_vertices[_polygons[i].start];}
+inline	const	sVERT *		vertices(const unsigned int i) const	{return &_vertices[_polygons[i].start];}
+
+private:
+	// Data members
+
+		std::vector<sVERT>	_vertices;
+		std::vector<sPOLYGON>	_polygons;
 };
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -82,6 +172,14 @@ public:
 class	Render
 {
 public:
+	// Antialiasing modes
+	//
+	// Supersampling renders (and shades) the entire scene once for each oversample offset. Multisampling rasterizes every
+	// subsample in a single pass, but only shades once per pixel for each polygon that covers it. Adaptive supersampling
+	// renders the scene once, and then only supersamples the pixels on geometric edges.
+
+	enum	AntialiasMode {AA_SUPERSAMPLE, AA_MULTISAMPLE, AA_ADAPTIVE};
+
 	// Construction/Destruction
 
 				Render();
@@ -91,29 +189,134 @@ virtual				~Render();
 
 	// Render a scene
 	//
-	// Loads tht texture from 'filename' and the 3DS file from sceneFilename.
+	// Loads tht texture from 'filename' and renders it onto the (already loaded) scene.
+
+virtual		void		renderScene(const std::string & textureFilename, const std::string & imageFilename, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const unsigned int quality, const sPHONG & phong);
 
-virtual		void		renderScene(const std::string & textureFilename, const std::string & imageFilename, const std::string & sceneFilename, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const unsigned int quality, const sPHONG & phong);
+	// Render a scene (deferred)
+	//
+	// Same as renderScene(), except that the first call lights every oversample render of the scene into a G-buffer. Every call
+	// (including the first) then simply applies the texture to the G-buffer. Since nothing but the texture changes during a
+	// batch, the scene and its parameters are ignored after the first call.
+
+virtual		void		renderSceneDeferred(const std::string & textureFilename, const std::string & imageFilename, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const unsigned int quality, const sPHONG & phong);
+
+	// Render a texture
+	//
+	// The render stage of renderScene() on its own: renders an (already loaded) texture onto the scene, into an image that is
+	// already allocated at the render size. This is for callers that load and save the images elsewhere (see the batch
+	// pipeline in texturebin.cpp.)
+
+virtual		void		renderTexture(Jpeg & image, const Jpeg & texture, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const sPHONG & phong);
+
+	// Render a texture (deferred)
+	//
+	// The shade stage of renderSceneDeferred() on its own. The scene is lit into the G-buffer first, if it hasn't been already.
+	//
+	// The second form shades with a G-buffer that's already lit, possibly by another renderer. It's only read, so renderers
+	// running at the same time can share one (see the batch pipeline in texturebin.cpp, which lights the scene once.)
+
+virtual		void		renderTextureDeferred(Jpeg & image, const Jpeg & texture, Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const sPHONG & phong);
+virtual		void		renderTextureDeferred(Jpeg & image, const Jpeg & texture, const GBuffer & gBuffer);
+
+	// Lights every oversample render of the scene into the G-buffer
+
+virtual		void		lightScene(Scene & scene, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY, const sPHONG & phong);
 
 	// Imports a scene
 	//
 	// The filename refers to a 3ds file. The scene is loaded and a set of primitives containing all of the geometry is generated.
-	// Also, if a camera exists in the 3DS file, it's information is stored in the last four parameters. If no camera exits, a
+	// Also, if a camera exists in the 3DS file, it's information is stored in the camera parameters. If no camera exits, a
 	// default camera is generated from hard-coded constants in this routine.
+	//
+	// The vertices of each mesh are welded first (see sWELD), counting the welded vertices into stats, if given. Welding
+	// hashes the vertices by position, so it takes time in proportion to the size of the mesh.
+	//
+	// Each mesh that has any polygons is added to meshes, as the range of primitives it became (see sMESH.)
+
+static		void		importScene(const std::string & filename, const sWELD & weld, std::vector<primitive<> > & primitives, std::vector<sMESH> & meshes, std::vector<sLIGHT> & lights, Point4 & cameraPosition, Vector3 & cameraDirection, float & cameraBank, float & cameraFOV, Stats * stats = NULL);
 
-static		void		importScene(const std::string & filename, std::vector<primitive<> > & primitives, std::vector<sLIGHT> & lights, Point4 & cameraPosition, Vector3 & cameraDirection, float & cameraBank, float & cameraFOV);
+	// Calculates the bounds of a mesh (its start and count must already be set) from its primitives' world positions
 
-	// Prepares for rendering -- transforms, clips and projects polygons and returns a simple list of vertices for rendering
+static		void		calcMeshBounds(sMESH & mesh, const std::vector<primitive<> > & primitives);
+
+	// Returns the camera that a light's shadow map is rendered from
+
+static		Camera		shadowMapCamera(const sLIGHT & light, const sPHONG & phong);
+
+	// Renders a shadow map for each light (counting the texels written into stats, if given.) The maps are rendered
+	// concurrently, and split into bands when there are fewer lights than threads. The geometry is culled and sorted for each
+	// light, as in transformAndClip(), and anything beyond the light's outer range is culled too (it can't cast a shadow on
+	// anything the light reaches.)
+
+static		void		renderShadowMaps(std::vector<ShadowMap> & shadowMaps, const std::vector<primitive<> > & primitives, const std::vector<sMESH> & meshes, const Bvh * bvh, const std::vector<sLIGHT> & lights, const sPHONG & phong, ThreadPool & threads, Stats * stats = NULL);
+
+	// Culls the geometry for a view, filling 'order' with the primitives to draw, nearest first
+	//
+	// With a BVH (and BVH culling enabled -- see Bvh.h) the nodes that are entirely outside the view volume are culled, and the
+	// rest come out in front-to-back order. Otherwise the meshes are culled the same way, and sorted by the depth of their
+	// centers. With neither, every primitive is drawn in order. If range is non-zero, anything entirely farther than that from
+	// the camera is culled as well. If stats are given, the nodes (or meshes) are counted as they're tested and culled.
+
+static		void		cullPrimitives(std::vector<unsigned int> & order, const Camera & camera, const Matrix4 & xform, const unsigned int primitiveCount, const std::vector<sMESH> & meshes, const Bvh * bvh, const float range = 0, Stats * stats = NULL);
+
+	// Prepares for rendering -- transforms, clips and projects polygons into the (cleared) vertex arena for rendering
+	//
+	// The geometry is culled first (see cullPrimitives()), so only what might be visible is transformed, and it's emitted nearest
+	// first, so that the depth tests (and the hierarchical z-buffer) reject as much as possible.
+	//
+	// Texture coordinates are scaled by the texture dimensions. Pass 1x1 for normalized texture coordinates. If stats are given,
+	// the culling is counted, along with the polygons as they're culled, rejected, clipped and emitted.
 
-static		sVERT *		transformAndClip(const Camera & camera, const Matrix4 & xform, const Jpeg & texture, std::vector<primitive<> > & primitives, unsigned int & renderPolygonCount);
+static		void		transformAndClip(VertexArena & polygons, const Camera & camera, const Matrix4 & xform, const unsigned int textureWidth, const unsigned int textureHeight, const std::vector<primitive<> > & primitives, const std::vector<sMESH> & meshes, const Bvh * bvh, Stats * stats = NULL, const float range = 0);
 
 	// Draws stuff to the frame buffer
+	//
+	// The oversample renders are rendered concurrently by the thread pool, each thread with its own frame, z and accumulation
+	// buffers (the latter are then reduced into one.) When there are fewer renders than threads, each render is also split into
+	// horizontal bands. The result is identical regardless of the number of threads.
+	//
+	// If adaptive is set, the first render is used to find the edges (see findEdges()) and the rest of the renders only draw
+	// the edge pixels. Every other pixel just uses the color from the first render. If progress is set, the number of renders
+	// completed so far is printed along the way. If stats are given, the passes and pixels are counted.
+	//
+	// If depthPrepass is set, each render draws just the depths first, and then only shades the visible pixels (see TMap.h.)
+
+static		void		renderGeometry(Jpeg & image, const Camera & camera, const sPHONG & phong, const VertexArena & polygons, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const Jpeg & texture, ThreadPool & threads, const bool adaptive = false, const bool progress = true, Stats * stats = NULL, const bool depthPrepass = false);
+
+	// Draws stuff to the frame buffer, multisampled
+	//
+	// Coverage and depth are determined for each subsample (the same subsample locations as renderGeometry() uses) but each
+	// polygon is only shaded once per pixel. The subsamples are resolved into the accumulation buffer and then downsampled.
 
-static		void		renderGeometry(Jpeg & image, const Camera & camera, const sPHONG & phong, const sVERT * renderVertices, const unsigned int renderPolygonCount, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const Jpeg & texture);
+static		void		renderGeometryMultisampled(Jpeg & image, const Camera & camera, const sPHONG & phong, const VertexArena & polygons, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const Jpeg & texture, ThreadPool & threads, Stats * stats = NULL);
 
-	// Draws stuff to the z-buffer only for use in shadow mapping
+	// Splits the screen into (at most) bandCount horizontal bands, and builds a list of the polygons that touch each band
 
-static		void		renderShadowMap(ShadowMap & map, const Camera & camera, sVERT * renderVertices, const unsigned int renderPolygonCount);
+static		void		binPolygons(std::vector<std::vector<unsigned int> > & bins, unsigned int & bandHeight, const Camera & camera, const VertexArena & polygons, const unsigned int bandCount, const unsigned int bandAlignment = 1);
+
+	// Lights every oversample render into the G-buffer (the G-buffer's camera must already be setup)
+	//
+	// The renders are lit concurrently by the thread pool, in bands when there are fewer renders than threads, just like
+	// renderGeometry(). The G-buffer is identical regardless of the number of threads.
+
+static		void		renderGBuffer(GBuffer & gBuffer, const sPHONG & phong, const VertexArena & polygons, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, ThreadPool & threads, const bool progress = true, Stats * stats = NULL);
+
+	// Applies a texture to a G-buffer, producing the final (downsampled) image
+	//
+	// The screen is split into bands that are shaded (and downsampled) concurrently by the thread pool. The G-buffer is only
+	// read, so it can be shared by renders that are running at the same time.
+
+static		void		shadeGBuffer(Jpeg & image, const GBuffer & gBuffer, const Jpeg & texture, ThreadPool & threads);
+
+	// Builds an edge mask for adaptive antialiasing
+	//
+	// A pixel is on an edge if any of its 8 neighbors belongs to a different polygon and either one of them is uncovered (the
+	// ID buffer holds -1 for uncovered pixels) or their depths are discontinuous. Returns the number of edge pixels.
+
+static		unsigned int	findEdges(unsigned char * mask, const int * idBuffer, const float * zBuffer, const unsigned int width, const unsigned int height);
+
+	// The pixel format routines below use the SIMD versions in Pixels.h when a SIMD span shader is selected (see Span.h)
 
 	// Simply converts an image from 32-bits to 24-bits
 
@@ -130,6 +333,13 @@ static		void		convert24To32(unsigned int * dest, const unsigned char * source, c
 
 static		void		accumulateBuffer(unsigned int * accumBuffer, const unsigned int * frameBuffer, const unsigned int width, const unsigned int height);
 
+	// Resolve a multisampled buffer
+	//
+	// The sample buffer contains sampleCount consecutive 32-bit samples for each pixel. The samples for each pixel are summed
+	// (per color component) and added to the accum buffer, ready for downsample().
+
+static		void		resolveSamples(unsigned int * accumBuffer, const unsigned int * sampleBuffer, const unsigned int width, const unsigned int height, const unsigned int sampleCount);
+
 	// Downsample an image
 	//
 	// The input buffer contains an oversampled image, where the total of all images are added together for each pixel.
@@ -137,6 +347,40 @@ static		void		accumulateBuffer(unsigned int * accumBuffer, const unsigned int *
 	// renders (oversampleX * oversampleY) and convert it to a standard 32-bit image.
 
 static		void		downsample(unsigned int * buffer, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY);
+
+	// Downsample an image straight to 24-bits
+	//
+	// The same as downsample() followed by convert32To24(), in a single pass (and without touching the accum buffer.)
+
+static		void		downsampleTo24(unsigned char * dest, const unsigned int * accumBuffer, const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY);
+
+	// Accessors
+
+inline		GBuffer &	gBuffer()	{return _gBuffer;}
+inline	const	GBuffer &	gBuffer() const	{return _gBuffer;}
+inline		VertexArena &	vertexArena()	{return _vertexArena;}
+inline	const	VertexArena &	vertexArena() const	{return _vertexArena;}
+inline		ThreadPool &	threads()	{return _threads;}
+inline	const	ThreadPool &	threads() const	{return _threads;}
+inline		AntialiasMode &	antialiasMode()	{return _antialiasMode;}
+inline	const	AntialiasMode	antialiasMode() const	{return _antialiasMode;}
+inline		bool &		verbose()	{return _verbose;}
+inline	const	bool		verbose() const	{return _verbose;}
+inline		bool &		depthPrepass()	{return _depthPrepass;}
+inline	const	bool		depthPrepass() const	{return _depthPrepass;}
+inline		Stats *&	stats()		{return _stats;}
+inline	const	Stats *		stats() const	{return _stats;}
+
+private:
+	// Data members
+
+		GBuffer		_gBuffer;
+		VertexArena	_vertexArena;	// Reused by each render
+		ThreadPool	_threads;
+		AntialiasMode	_antialiasMode;
+		bool		_verbose;	// Print the progress of each render
+		bool		_depthPrepass;	// Draw the depths before shading (see renderGeometry())
+		Stats *		_stats;		// If set, the renders are timed & counted into these
 };
 
 #endif // _H_RENDER
@@ -0,0 +1,617 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____                                           
+//  / ____|                                          
+// | (___   ___  ___ _ __   ___      ___ _ __  _ __  
+//  \___ \ / __|/ _ \ '_ \ / _ \    / __| '_ \| '_ \ 
+//  ____) | (__|  __/ | | |  __/ _ | (__| |_) | |_) |
+// |_____/ \___|\___|_| |_|\___|(_) \___| .__/| .__/ 
+//                                      | |   | |    
+//                                      |_|   |_|    
+//
+// Description:
+//
+//   A loaded scene -- everything about a render that doesn't change from one texture to the next
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "texturebin.h"
+#include "scene.h"
+#include "stats.h"
+#include "mappedfile.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Compiled scenes
+//
+// The header is followed by the lights, the geometry and the meshes, each at the offset given in the header (16-byte aligned.) The
+// geometry is stored as flat arrays over the vertices of every polygon (three per polygon, in order): positions (x, y, z), normals
+// (x, y, z) and texture coordinates (u, v.) That's exactly what the primitives are built from, so loading is nothing more than
+// copying them straight out of the mapped file. The meshes are just the first polygon and polygon count of each (their bounds are
+// recalculated as they're loaded.) Everything is in the native byte order -- these are caches, not for interchange.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	const	char		compiledMagic[8] = {'T', 'B', 'S', 'C', 'E', 'N', 'E', 0};
+static	const	unsigned int	compiledVersion = 2;
+static	const	char		compiledExtension[] = ".tbscene";
+static	const	unsigned int	compiledLightFloats = 14;	// pos (4), dir (3), color (3), innerRange, outerRange, hotspot, falloff
+
+typedef	struct
+{
+	char		magic[8];
+	unsigned int	version;
+	unsigned int	fileSize;
+	unsigned int	sourceHash[2];		// Hash of the 3DS file (see hashData())
+	unsigned int	sourceSize;
+	unsigned int	weldEnabled;		// The sWELD used to import it
+	float		weldTolerance;
+	float		cameraPosition[4];
+	float		cameraDirection[3];
+	float		cameraBank;
+	float		cameraFOV;
+	unsigned int	lightCount;
+	unsigned int	lightOffset;
+	unsigned int	polygonCount;
+	unsigned int	positionOffset;
+	unsigned int	normalOffset;
+	unsigned int	textureOffset;
+	unsigned int	meshCount;
+	unsigned int	meshOffset;
+} sCOMPILEDSCENE;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Shadow caches
+//
+// The header is followed by the z-buffer of each shadow map (one per light, in order), starting at mapOffset (16-byte aligned.)
+// Like compiled scenes, they're stored in the native byte order.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	const	char		shadowCacheMagic[8] = {'T', 'B', 'S', 'H', 'A', 'D', 'O', 'W'};
+static	const	unsigned int	shadowCacheVersion = 2;
+static	const	char		shadowCacheExtension[] = ".tbshadow";
+
+typedef	struct
+{
+	char		magic[8];
+	unsigned int	version;
+	unsigned int	fileSize;
+	unsigned int	key[2];			// See Scene::shadowCacheKey()
+	unsigned int	mapCount;
+	unsigned int	width;
+	unsigned int	height;
+	unsigned int	mapOffset;
+} sSHADOWCACHE;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	unsigned int	alignOffset(const unsigned int offset)
+{
+	return (offset + 15) & ~15;
+}
+
+static	bool	isCompiledFilename(const std::string & filename)
+{
+	const	unsigned int	extLength = sizeof(compiledExtension) - 1;
+	return filename.length() > extLength && !stricmp(filename.c_str() + filename.length() - extLength, compiledExtension);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	Scene::Scene()
+	: _cameraBank(0), _cameraFOV(0)
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	Scene::~Scene()
+{
+	reset();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Scene::reset()
+{
+	name().erase();
+	primitives().clear();
+	meshes().clear();
+	bvh().clear();
+	lights().clear();
+
+	for (unsigned int i = 0; i < shadowMaps().size(); ++i)
+	{
+		delete[] shadowMaps()[i].zBuffer;
+	}
+	shadowMaps().clear();
+}
+
+static	std::string	replaceExtension(const std::string & filename, const char * extension)
+{
+	std::string		result = filename;
+	std::string::size_type	dot = result.rfind('.');
+	std::string::size_type	slash = result.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) result.erase(dot);
+	return result.append(extension);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Scene::load(const std::string & filename, const sWELD & weld, const sPHONG & phong, const std::string & shadowCacheFilename, const unsigned int threadCount, Stats * stats)
+{
+	reset();
+
+	try
+	{
+		name() = filename;
+
+		printf("scene: ");
+
+		{
+			StageTimer	timer(stats, Stats::STAGE_IMPORT);
+
+			if (loadCompiled(filename, weld))
+			{
+				printf("compiled scene...");
+			}
+			else
+			{
+				printf("3D import...");
+				Render::importScene(filename, weld, primitives(), meshes(), lights(), cameraPosition(), cameraDirection(), cameraBank(), cameraFOV(), stats);
+			}
+
+			// The BVH only takes a moment to build (a fraction of the import), so it isn't worth keeping in the compiled scene
+
+			bvh().build(primitives());
+		}
+
+		{
+			StageTimer	timer(stats, Stats::STAGE_SHADOWS);
+
+			if (phong.shadowMapRes <= 0)
+			{
+				// No shadows at all (the lights reach everything in range -- see lightTerms() in TMap.cpp)
+
+				printf("no shadows...");
+			}
+			else if (phong.shadowRays)
+			{
+				// Shadow maps with no z-buffers, just for the rays
+
+				printf("shadow rays...");
+
+				for (unsigned int i = 0; i < lights().size(); ++i)
+				{
+					ShadowMap	map;
+					map.camera = Render::shadowMapCamera(lights()[i], phong);
+					map.xform = map.camera.calcTransform();
+					map.bvh = &bvh();
+					shadowMaps().push_back(map);
+				}
+			}
+			else if (shadowCacheFilename.length() && loadShadowMaps(shadowCacheFilename, phong))
+			{
+				printf("cached shadows...");
+			}
+			else
+			{
+				printf("shadows...");
+
+				ThreadPool	threads;
+				threads.start(threadCount);
+				Render::renderShadowMaps(shadowMaps(), primitives(), meshes(), &bvh(), lights(), phong, threads, stats);
+				if (shadowCacheFilename.length()) saveShadowMaps(shadowCacheFilename, phong);
+			}
+		}
+
+		printf("done.\n");
+	}
+	catch(...)
+	{
+		// Cleanup
+
+		reset();
+
+		// Rethrow
+
+		throw;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Scene::compile(const std::string & filename, const sWELD & weld)
+{
+	reset();
+
+	try
+	{
+		if (isCompiledFilename(filename)) throw std::string("The scene is already compiled: ").append(filename);
+
+		name() = filename;
+
+		printf("scene: 3D import...");
+		Render::importScene(filename, weld, primitives(), meshes(), lights(), cameraPosition(), cameraDirection(), cameraBank(), cameraFOV());
+
+		printf("compiling...");
+
+		// The 3DS file's hash (it was just read, so this is quick)
+
+		MappedFile	source;
+		if (!source.open(filename)) throw std::string("Unable to open input scene file: ").append(filename);
+
+		// Header
+
+		sCOMPILEDSCENE	header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, compiledMagic, sizeof(header.magic));
+		header.version = compiledVersion;
+		hashData(source.data(), source.size(), header.sourceHash);
+		header.sourceSize = source.size();
+		header.weldEnabled = weld.enabled ? 1:0;
+		header.weldTolerance = weld.tolerance;
+		for (unsigned int i = 0; i < 4; ++i) header.cameraPosition[i] = cameraPosition()(i, 0);
+		for (unsigned int i = 0; i < 3; ++i) header.cameraDirection[i] = cameraDirection()(i, 0);
+		header.cameraBank = cameraBank();
+		header.cameraFOV = cameraFOV();
+		header.lightCount = static_cast<unsigned int>(lights().size());
+		header.polygonCount = static_cast<unsigned int>(primitives().size());
+		header.meshCount = static_cast<unsigned int>(meshes().size());
+
+		unsigned int	vertexCount = header.polygonCount * 3;
+		header.lightOffset = alignOffset(sizeof(header));
+		header.positionOffset = alignOffset(header.lightOffset + header.lightCount * compiledLightFloats * sizeof(float));
+		header.normalOffset = alignOffset(header.positionOffset + vertexCount * 3 * sizeof(float));
+		header.textureOffset = alignOffset(header.normalOffset + vertexCount * 3 * sizeof(float));
+		header.meshOffset = alignOffset(header.textureOffset + vertexCount * 2 * sizeof(float));
+		header.fileSize = header.meshOffset + header.meshCount * 2 * sizeof(unsigned int);
+
+		// Build the file
+
+		std::vector<unsigned char>	file(header.fileSize, 0);
+		memcpy(&file[0], &header, sizeof(header));
+
+		float *	light = reinterpret_cast<float *>(&file[header.lightOffset]);
+		for (unsigned int i = 0; i < header.lightCount; ++i)
+		{
+			const sLIGHT &	l = lights()[i];
+			for (unsigned int j = 0; j < 4; ++j) *(light++) = l.pos(j, 0);
+			for (unsigned int j = 0; j < 3; ++j) *(light++) = l.dir(j, 0);
+			for (unsigned int j = 0; j < 3; ++j) *(light++) = l.color(j, 0);
+			*(light++) = l.innerRange;
+			*(light++) = l.outerRange;
+			*(light++) = l.hotspot;
+			*(light++) = l.falloff;
+		}
+
+		float *	position = reinterpret_cast<float *>(&file[header.positionOffset]);
+		float *	normal = reinterpret_cast<float *>(&file[header.normalOffset]);
+		float *	texture = reinterpret_cast<float *>(&file[header.textureOffset]);
+		for (unsigned int i = 0; i < header.polygonCount; ++i)
+		{
+			const primitive<> &	p = primitives()[i];
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				const vert<> &	v = p[j];
+				*(position++) = v.world().x();	*(position++) = v.world().y();	*(position++) = v.world().z();
+				*(normal++) = v.normal().x();	*(normal++) = v.normal().y();	*(normal++) = v.normal().z();
+				*(texture++) = v.texture().x();	*(texture++) = v.texture().y();
+			}
+		}
+
+		unsigned int *	mesh = reinterpret_cast<unsigned int *>(&file[header.meshOffset]);
+		for (unsigned int i = 0; i < header.meshCount; ++i)
+		{
+			*(mesh++) = meshes()[i].start;
+			*(mesh++) = meshes()[i].count;
+		}
+
+		// Write it
+
+		std::string	compiledName = compiledFilename(filename);
+		FILE *		fp = fopen(compiledName.c_str(), "wb");
+		if (!fp) throw std::string("Unable to create compiled scene file: ").append(compiledName);
+
+		bool	written = fwrite(&file[0], file.size(), 1, fp) == 1;
+		if (fclose(fp)) written = false;
+		if (!written) throw std::string("Unable to write compiled scene file: ").append(compiledName);
+
+		printf("done (%s).\n", compiledName.c_str());
+	}
+	catch(...)
+	{
+		reset();
+		throw;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+std::string	Scene::compiledFilename(const std::string & filename)
+{
+	return replaceExtension(filename, compiledExtension);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+std::string	Scene::shadowCacheFilename(const std::string & filename)
+{
+	return replaceExtension(filename, shadowCacheExtension);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	Scene::loadCompiled(const std::string & filename, const sWELD & weld)
+{
+	// A compiled scene given directly is always used (and must be valid.) Otherwise, the compiled scene is only used if it's
+	// current -- if not, the 3DS file is simply imported.
+
+	bool		direct = isCompiledFilename(filename);
+	MappedFile	file;
+
+	if (direct)
+	{
+		if (!file.open(filename)) throw std::string("Unable to open compiled scene file: ").append(filename);
+	}
+	else
+	{
+		// Saving the welded scene needs the 3DS file
+
+		if (weld.saveFilename.length()) return false;
+		if (!file.open(compiledFilename(filename))) return false;
+	}
+
+	// Validate the header
+
+	const	sCOMPILEDSCENE *	header = reinterpret_cast<const sCOMPILEDSCENE *>(file.data());
+	bool				valid = file.size() >= sizeof(sCOMPILEDSCENE) && !memcmp(header->magic, compiledMagic, sizeof(compiledMagic)) &&
+					header->version == compiledVersion && header->fileSize == file.size();
+
+	if (valid)
+	{
+		const	unsigned int	maxVertices = file.size() / (8 * sizeof(float));
+		const	unsigned int	vertexCount = header->polygonCount * 3;
+		valid = header->lightCount <= file.size() / (compiledLightFloats * sizeof(float)) && header->polygonCount <= maxVertices / 3 &&
+			!(header->lightOffset & 15) && !(header->positionOffset & 15) && !(header->normalOffset & 15) && !(header->textureOffset & 15) &&
+			header->lightOffset >= sizeof(sCOMPILEDSCENE) && header->lightOffset <= file.size() &&
+			file.size() - header->lightOffset >= header->lightCount * compiledLightFloats * sizeof(float) &&
+			header->positionOffset <= file.size() && file.size() - header->positionOffset >= vertexCount * 3 * sizeof(float) &&
+			header->normalOffset <= file.size() && file.size() - header->normalOffset >= vertexCount * 3 * sizeof(float) &&
+			header->textureOffset <= file.size() && file.size() - header->textureOffset >= vertexCount * 2 * sizeof(float) &&
+			!(header->meshOffset & 15) && header->meshCount <= header->polygonCount &&
+			header->meshOffset <= file.size() && file.size() - header->meshOffset >= header->meshCount * 2 * sizeof(unsigned int);
+	}
+
+	// The meshes must be in order, and can't run past the polygons
+
+	if (valid)
+	{
+		const unsigned int *	mesh = reinterpret_cast<const unsigned int *>(file.data() + header->meshOffset);
+		unsigned int		next = 0;
+		for (unsigned int i = 0; i < header->meshCount && valid; ++i, mesh += 2)
+		{
+			valid = mesh[0] >= next && mesh[0] <= header->polygonCount && mesh[1] <= header->polygonCount - mesh[0];
+			next = mesh[0] + mesh[1];
+		}
+	}
+
+	if (!valid)
+	{
+		if (direct) throw std::string("Invalid compiled scene file: ").append(filename);
+		return false;
+	}
+
+	// Is it current?
+
+	if (!direct)
+	{
+		if (header->weldEnabled != (weld.enabled ? 1u:0u) || (weld.enabled && header->weldTolerance != weld.tolerance)) return false;
+
+		MappedFile	source;
+		if (!source.open(filename) || source.size() != header->sourceSize) return false;
+
+		unsigned int	hash[2];
+		hashData(source.data(), source.size(), hash);
+		if (hash[0] != header->sourceHash[0] || hash[1] != header->sourceHash[1]) return false;
+	}
+
+	// Camera & lights
+
+	cameraPosition() = Point4(header->cameraPosition[0], header->cameraPosition[1], header->cameraPosition[2], header->cameraPosition[3]);
+	cameraDirection() = Vector3(header->cameraDirection[0], header->cameraDirection[1], header->cameraDirection[2]);
+	cameraBank() = header->cameraBank;
+	cameraFOV() = header->cameraFOV;
+
+	const float *	light = reinterpret_cast<const float *>(file.data() + header->lightOffset);
+	lights().resize(header->lightCount);
+	for (unsigned int i = 0; i < header->lightCount; ++i, light += compiledLightFloats)
+	{
+		sLIGHT &	l = lights()[i];
+		l.pos = Point4(light[0], light[1], light[2], light[3]);
+		l.dir = Vector3(light[4], light[5], light[6]);
+		l.color = Point3(light[7], light[8], light[9]);
+		l.innerRange = light[10];
+		l.outerRange = light[11];
+		l.hotspot = light[12];
+		l.falloff = light[13];
+	}
+
+	// The primitives, straight from the arrays
+
+	const float *	position = reinterpret_cast<const float *>(file.data() + header->positionOffset);
+	const float *	normal = reinterpret_cast<const float *>(file.data() + header->normalOffset);
+	const float *	texture = reinterpret_cast<const float *>(file.data() + header->textureOffset);
+
+	primitives().resize(header->polygonCount);
+	vert<>	v;
+	for (unsigned int i = 0; i < header->polygonCount; ++i)
+	{
+		primitive<> &	p = primitives()[i];
+		p.vertices().reserve(3);
+		for (unsigned int j = 0; j < 3; ++j, position += 3, normal += 3, texture += 2)
+		{
+			v.world() = Point4(position[0], position[1], position[2], 1);
+			v.normal() = Vector3(normal[0], normal[1], normal[2]);
+			v.texture() = Point2(texture[0], texture[1]);
+			p += v;
+		}
+		p.calcPlane(false);
+	}
+
+	// The meshes
+
+	const unsigned int *	mesh = reinterpret_cast<const unsigned int *>(file.data() + header->meshOffset);
+	meshes().resize(header->meshCount);
+	for (unsigned int i = 0; i < header->meshCount; ++i, mesh += 2)
+	{
+		meshes()[i].start = mesh[0];
+		meshes()[i].count = mesh[1];
+		Render::calcMeshBounds(meshes()[i], primitives());
+	}
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Scene::shadowCacheKey(const sPHONG & phong, unsigned int key[2]) const
+{
+	// Everything the shadow maps depend on, gathered up and hashed in one go (the normals and texture coordinates don't matter)
+
+	std::vector<float>	data;
+	data.reserve(primitives().size() * 9 + lights().size() * 12 + 3);
+
+	// The rasterizers differ right at the polygon edges, and the culling (which also uses each light's range) changes what the
+	// filtering sees at the edges of what's culled
+
+	data.push_back(static_cast<float>(rasterizer()));
+	data.push_back(bvhCulling() ? 1.0f : 0.0f);
+	data.push_back(static_cast<float>(primitives().size()));
+	for (unsigned int i = 0; i < primitives().size(); ++i)
+	{
+		const primitive<> &	p = primitives()[i];
+		for (unsigned int j = 0; j < p.vertexCount(); ++j)
+		{
+			data.push_back(p[j].world().x());
+			data.push_back(p[j].world().y());
+			data.push_back(p[j].world().z());
+		}
+	}
+
+	for (unsigned int i = 0; i < lights().size(); ++i)
+	{
+		Camera	camera = Render::shadowMapCamera(lights()[i], phong);
+		for (unsigned int j = 0; j < 4; ++j) data.push_back(camera.position(j, 0));
+		for (unsigned int j = 0; j < 3; ++j) data.push_back(camera.direction(j, 0));
+		data.push_back(camera.bank);
+		data.push_back(camera.fov);
+		data.push_back(static_cast<float>(camera.width));
+		data.push_back(static_cast<float>(camera.height));
+		data.push_back(lights()[i].outerRange);
+	}
+
+	hashData(reinterpret_cast<const unsigned char *>(&data[0]), static_cast<unsigned int>(data.size() * sizeof(float)), key);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	Scene::loadShadowMaps(const std::string & cacheFilename, const sPHONG & phong)
+{
+	MappedFile	file;
+	if (!file.open(cacheFilename)) return false;
+
+	// Validate the header
+
+	const	sSHADOWCACHE *	header = reinterpret_cast<const sSHADOWCACHE *>(file.data());
+	if (file.size() < sizeof(sSHADOWCACHE) || memcmp(header->magic, shadowCacheMagic, sizeof(shadowCacheMagic)) ||
+	    header->version != shadowCacheVersion || header->fileSize != file.size()) return false;
+
+	unsigned int	key[2];
+	shadowCacheKey(phong, key);
+	if (header->key[0] != key[0] || header->key[1] != key[1] || header->mapCount != lights().size()) return false;
+
+	// The maps are all the same size (the key covers their cameras, so that's just a check that they all fit in the file)
+
+	unsigned int	texels = header->width * header->height;
+	if (header->mapCount && (header->width != static_cast<unsigned int>(phong.shadowMapRes) || header->height != header->width ||
+	    (header->mapOffset & 15) || header->mapOffset < sizeof(sSHADOWCACHE) || header->mapOffset > file.size() ||
+	    (file.size() - header->mapOffset) / sizeof(float) / texels < header->mapCount)) return false;
+
+	for (unsigned int i = 0; i < lights().size(); ++i)
+	{
+		ShadowMap	map;
+		map.camera = Render::shadowMapCamera(lights()[i], phong);
+		map.xform = map.camera.calcTransform();
+		map.zBuffer = new float[texels];
+		memcpy(map.zBuffer, file.data() + header->mapOffset + i * texels * sizeof(float), texels * sizeof(float));
+		shadowMaps().push_back(map);
+	}
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Scene::saveShadowMaps(const std::string & cacheFilename, const sPHONG & phong) const
+{
+	sSHADOWCACHE	header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, shadowCacheMagic, sizeof(header.magic));
+	header.version = shadowCacheVersion;
+	shadowCacheKey(phong, header.key);
+	header.mapCount = static_cast<unsigned int>(shadowMaps().size());
+	header.width = header.mapCount ? shadowMaps()[0].camera.width : 0;
+	header.height = header.mapCount ? shadowMaps()[0].camera.height : 0;
+	header.mapOffset = alignOffset(sizeof(header));
+
+	unsigned int	mapSize = header.width * header.height * sizeof(float);
+	header.fileSize = header.mapOffset + header.mapCount * mapSize;
+
+	// The maps are large, so they're written straight from the z-buffers
+
+	FILE *	fp = fopen(cacheFilename.c_str(), "wb");
+	if (!fp) throw std::string("Unable to create shadow cache file: ").append(cacheFilename);
+
+	char	padding[16] = {0};
+	bool	written = fwrite(&header, sizeof(header), 1, fp) == 1;
+	if (header.mapOffset > sizeof(header)) written = written && fwrite(padding, header.mapOffset - sizeof(header), 1, fp) == 1;
+	for (unsigned int i = 0; i < header.mapCount && mapSize; ++i)
+	{
+		written = written && fwrite(shadowMaps()[i].zBuffer, mapSize, 1, fp) == 1;
+	}
+	if (fclose(fp)) written = false;
+	if (!written) throw std::string("Unable to write shadow cache file: ").append(cacheFilename);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+Camera	Scene::camera(const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY) const
+{
+	Camera	cam;
+	cam.position = cameraPosition();
+	cam.direction = cameraDirection();
+	cam.bank = cameraBank();
+	cam.fov = cameraFOV();
+	cam.width = width;
+	cam.height = height;
+	cam.oversampleX = oversampleX;
+	cam.oversampleY = oversampleY;
+	return cam;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Scene.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,150 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____                          _     
+//  / ____|                        | |    
+// | (___   ___  ___ _ __   ___    | |__  
+//  \___ \ / __|/ _ \ '_ \ / _ \   | '_ \ 
+//  ____) | (__|  __/ | | |  __/ _ | | | |
+// |_____/ \___|\___|_| |_|\___|(_)|_| |_|
+//                                        
+//                                        
+//
+// Description:
+//
+//   A loaded scene -- everything about a render that doesn't change from one texture to the next
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_SCENE
+#define _H_SCENE
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Module setup (required includes, macros, etc.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "render.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	Scene
+{
+public:
+	// Construction/Destruction
+
+					Scene();
+virtual					~Scene();
+
+	// Implementation
+
+virtual		void			reset();
+
+	// Loads a scene
+	//
+	// Imports the 3DS file (welding vertices as given and generating normals), builds a BVH over it and renders a shadow map for
+	// each light. The scene file and the lights never change during a batch, so this is done once and the result is shared by
+	// every texture that is rendered. If stats are given, the import and shadows are timed (and the welded vertices and shadow
+	// map texels counted) into them.
+	//
+	// With ray traced shadows (see sPHONG), the shadow maps are only set up to trace rays through the BVH, and nothing is
+	// rendered or cached.
+	//
+	// If a shadow cache filename is given, the shadow maps are read from it instead of rendered, as long as it holds the maps
+	// for this geometry, these lights and this shadow map resolution. Otherwise they're rendered (with 'threadCount' threads,
+	// 0 meaning one per processor) and saved to it.
+
+virtual		void			load(const std::string & filename, const sWELD & weld, const sPHONG & phong, const std::string & shadowCacheFilename = "", const unsigned int threadCount = 1, Stats * stats = NULL);
+
+	// Compiles a scene
+	//
+	// Imports the 3DS file and saves the result (the geometry, ready to render, with the lights and camera) as a compiled scene
+	// next to it, with the extension ".tbscene". From then on, load() reads the compiled scene instead of importing the 3DS
+	// file, as long as the 3DS file hasn't changed since (its contents are hashed) and it's welded the same way. A compiled
+	// scene can also be loaded directly, by its own filename.
+
+virtual		void			compile(const std::string & filename, const sWELD & weld);
+
+	// Returns the compiled scene filename for a 3DS file
+
+static		std::string		compiledFilename(const std::string & filename);
+
+	// Returns the default shadow cache filename for a scene file
+
+static		std::string		shadowCacheFilename(const std::string & filename);
+
+	// Returns the scene's camera, setup for the given render dimensions
+
+virtual		Camera			camera(const unsigned int width, const unsigned int height, const unsigned int oversampleX, const unsigned int oversampleY) const;
+
+	// Accessors
+
+inline		std::string &		name()			{return _name;}
+inline	const	std::string		name() const		{return _name;}
+inline		std::vector<primitive<> > &	primitives()	{return _primitives;}
+inline	const	std::vector<primitive<> > &	primitives() const {return _primitives;}
+inline		std::vector<sMESH> &	meshes()		{return _meshes;}
+inline	const	std::vector<sMESH> &	meshes() const		{return _meshes;}
+inline		Bvh &			bvh()			{return _bvh;}
+inline	const	Bvh &			bvh() const		{return _bvh;}
+inline		std::vector<sLIGHT> &	lights()		{return _lights;}
+inline	const	std::vector<sLIGHT> &	lights() const		{return _lights;}
+inline		std::vector<ShadowMap> &	shadowMaps()	{return _shadowMaps;}
+inline	const	std::vector<ShadowMap> &	shadowMaps() const {return _shadowMaps;}
+inline		Point4 &		cameraPosition()	{return _cameraPosition;}
+inline	const	Point4 &		cameraPosition() const	{return _cameraPosition;}
+inline		Vector3 &		cameraDirection()	{return _cameraDirection;}
+inline	const	Vector3 &		cameraDirection() const	{return _cameraDirection;}
+inline		float &			cameraBank()		{return _cameraBank;}
+inline	const	float			cameraBank() const	{return _cameraBank;}
+inline		float &			cameraFOV()		{return _cameraFOV;}
+inline	const	float			cameraFOV() const	{return _cameraFOV;}
+
+private:
+	// Explicitly disallow copying this object (it owns the shadow map buffers)
+
+					Scene(const Scene & rhs) {}
+inline		Scene &			operator=(const Scene & rhs) {Scene * errptr = 0; return *errptr;}
+
+	// Loads the compiled scene for 'filename' (or 'filename' itself, if it's a compiled scene.) Returns false if there's no
+	// current compiled scene to load.
+
+virtual		bool			loadCompiled(const std::string & filename, const sWELD & weld);
+
+	// The shadow cache: the key is a hash of everything the shadow maps are rendered from (the positions of the geometry and
+	// each light's shadow map camera.) loadShadowMaps() returns false if the cache doesn't exist or has a different key.
+
+virtual		void			shadowCacheKey(const sPHONG & phong, unsigned int key[2]) const;
+virtual		bool			loadShadowMaps(const std::string & cacheFilename, const sPHONG & phong);
+virtual		void			saveShadowMaps(const std::string & cacheFilename, const sPHONG & phong) const;
+
+	// Data members
+
+		std::string		_name;
+		std::vector<primitive<> >	_primitives;
+		std::vector<sMESH>	_meshes;
+		Bvh			_bvh;
+		std::vector<sLIGHT>	_lights;
+		std::vector<ShadowMap>	_shadowMaps;
+		Point4			_cameraPosition;
+		Vector3			_cameraDirection;
+		float			_cameraBank;
+		float			_cameraFOV;
+};
+
+#endif // _H_SCENE
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Scene.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,312 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____                                        
+//  / ____|                                       
+// | (___  _ __   __ _ _ __       ___ _ __  _ __  
+//  \___ \| '_ \ / _` | '_ \     / __| '_ \| '_ \ 
+//  ____) | |_) | (_| | | | | _ | (__| |_) | |_) |
+// |_____/| .__/ \__,_|_| |_|(_) \___| .__/| .__/ 
+//        | |                        | |   | |    
+//        |_|                        |_|   |_|    
+//
+// Description:
+//
+//   SIMD span shaders for drawPerspectiveTexturedPolygon() -- the SSE2 shader, and the runtime selection of the shaders
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "texturebin.h"
+#include "span.h"
+#include "spansimd.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define	HAVE_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define	HAVE_SPAN_SSE2
+#include <emmintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The SSE2 vector types (see SpanSIMD.h)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifdef HAVE_SPAN_SSE2
+
+class	SSE2Int
+{
+public:
+	enum			{width = 4};
+
+inline				SSE2Int() {}
+inline				SSE2Int(const __m128i v) : _v(v) {}
+inline				SSE2Int(const int i) : _v(_mm_set1_epi32(i)) {}
+
+static	inline	SSE2Int		load(const int * p)	{return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));}
+inline		void		store(int * p) const	{_mm_storeu_si128(reinterpret_cast<__m128i *>(p), _v);}
+
+inline		__m128i		v() const		{return _v;}
+
+private:
+		__m128i		_v;
+};
+
+class	SSE2Float
+{
+public:
+	enum			{width = 4};
+
+inline				SSE2Float() {}
+inline				SSE2Float(const __m128 v) : _v(v) {}
+inline				SSE2Float(const float f) : _v(_mm_set1_ps(f)) {}
+
+static	inline	SSE2Float	load(const float * p)	{return _mm_loadu_ps(p);}
+inline		void		store(float * p) const	{_mm_storeu_ps(p, _v);}
+
+static	inline	SSE2Float	ramp()			{return _mm_setr_ps(0, 1, 2, 3);}
+static	inline	SSE2Float	laneMask(const int bits)
+				{
+					__m128i	lanes = _mm_setr_epi32(1, 2, 4, 8);
+					return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes));
+				}
+inline		int		bits() const		{return _mm_movemask_ps(_v);}
+
+inline		__m128		v() const		{return _v;}
+
+static	inline	void		cleanup()		{}
+
+private:
+		__m128		_v;
+};
+
+static	inline	SSE2Float	operator +(const SSE2Float & a, const SSE2Float & b)	{return _mm_add_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator -(const SSE2Float & a, const SSE2Float & b)	{return _mm_sub_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator *(const SSE2Float & a, const SSE2Float & b)	{return _mm_mul_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator /(const SSE2Float & a, const SSE2Float & b)	{return _mm_div_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator <(const SSE2Float & a, const SSE2Float & b)	{return _mm_cmplt_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator <=(const SSE2Float & a, const SSE2Float & b)	{return _mm_cmple_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator >(const SSE2Float & a, const SSE2Float & b)	{return _mm_cmpgt_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator >=(const SSE2Float & a, const SSE2Float & b)	{return _mm_cmpge_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator &(const SSE2Float & a, const SSE2Float & b)	{return _mm_and_ps(a.v(), b.v());}
+static	inline	SSE2Float	operator |(const SSE2Float & a, const SSE2Float & b)	{return _mm_or_ps(a.v(), b.v());}
+static	inline	SSE2Float	select(const SSE2Float & m, const SSE2Float & a, const SSE2Float & b)
+										{return _mm_or_ps(_mm_and_ps(m.v(), a.v()), _mm_andnot_ps(m.v(), b.v()));}
+static	inline	SSE2Float	squareRoot(const SSE2Float & a)				{return _mm_sqrt_ps(a.v());}
+static	inline	SSE2Float	minOf(const SSE2Float & a, const SSE2Float & b)		{return _mm_min_ps(a.v(), b.v());}
+static	inline	SSE2Float	maxOf(const SSE2Float & a, const SSE2Float & b)		{return _mm_max_ps(a.v(), b.v());}
+
+static	inline	SSE2Int		operator +(const SSE2Int & a, const SSE2Int & b)	{return _mm_add_epi32(a.v(), b.v());}
+static	inline	SSE2Int		operator &(const SSE2Int & a, const SSE2Int & b)	{return _mm_and_si128(a.v(), b.v());}
+static	inline	SSE2Int		operator |(const SSE2Int & a, const SSE2Int & b)	{return _mm_or_si128(a.v(), b.v());}
+static	inline	SSE2Int		shiftLeft(const SSE2Int & a, const int n)		{return _mm_sll_epi32(a.v(), _mm_cvtsi32_si128(n));}
+static	inline	SSE2Int		shiftRight(const SSE2Int & a, const int n)		{return _mm_srl_epi32(a.v(), _mm_cvtsi32_si128(n));}
+
+static	inline	SSE2Int		truncate(const SSE2Float & a)				{return _mm_cvttps_epi32(a.v());}
+static	inline	SSE2Int		roundToInt(const SSE2Float & a)				{return _mm_cvtps_epi32(a.v());}
+static	inline	SSE2Float	toFloat(const SSE2Int & a)				{return _mm_cvtepi32_ps(a.v());}
+static	inline	SSE2Int		floatToBits(const SSE2Float & a)			{return _mm_castps_si128(a.v());}
+static	inline	SSE2Float	bitsToFloat(const SSE2Int & a)				{return _mm_castsi128_ps(a.v());}
+
+// There's no gather in SSE2, so the lanes are fetched one at a time (the masked lanes fetch p[0] and are then cleared)
+
+static	inline	SSE2Float	gather(const float * p, const SSE2Int & index, const SSE2Float & mask)
+{
+	__m128i	i = _mm_and_si128(index.v(), _mm_castps_si128(mask.v()));
+	__m128	result = _mm_setr_ps(	p[_mm_cvtsi128_si32(i)],
+					p[_mm_cvtsi128_si32(_mm_shuffle_epi32(i, 1))],
+					p[_mm_cvtsi128_si32(_mm_shuffle_epi32(i, 2))],
+					p[_mm_cvtsi128_si32(_mm_shuffle_epi32(i, 3))]);
+	return _mm_and_ps(result, mask.v());
+}
+
+SpanShaderFunction	spanShaderSSE2(const unsigned int lightCount, const bool shadows)
+{
+	return selectSpanKernel<SSE2Float, SSE2Int>(lightCount, shadows);
+}
+
+const	bool	spanShaderSSE2Built = true;
+
+#else
+
+SpanShaderFunction	spanShaderSSE2(const unsigned int lightCount, const bool shadows)
+{
+	return NULL;
+}
+
+const	bool	spanShaderSSE2Built = false;
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Processor support
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifdef HAVE_X86
+
+static	void	cpuid(const unsigned int leaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+	int	r[4];
+	__cpuidex(r, leaf, 0);
+	for (unsigned int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(r[i]);
+#else
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// AVX2 needs the processor to support it, and the OS to save the AVX registers (OSXSAVE, and XCR0 with the SSE & AVX state set)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	bool	processorSupports(const SpanShader shader)
+{
+	unsigned int	regs[4];
+	cpuid(0, regs);
+	unsigned int	maxLeaf = regs[0];
+	if (maxLeaf < 1) return false;
+
+	cpuid(1, regs);
+	if (shader == SPAN_SSE2) return (regs[3] & (1 << 26)) != 0;
+	if (shader != SPAN_AVX2) return false;
+
+	const	unsigned int	osxsave = 1 << 27, avx = 1 << 28;
+	if ((regs[2] & (osxsave | avx)) != (osxsave | avx)) return false;
+
+#ifdef _MSC_VER
+	unsigned __int64	xcr0 = _xgetbv(0);
+#else
+	unsigned int	xcr0Low, xcr0High;
+	__asm__ __volatile__ ("xgetbv" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0));
+	unsigned int	xcr0 = xcr0Low;
+#endif
+	if ((xcr0 & 6) != 6) return false;
+
+	if (maxLeaf < 7) return false;
+	cpuid(7, regs);
+	return (regs[1] & (1 << 5)) != 0;
+}
+
+#else
+
+static	bool	processorSupports(const SpanShader shader)
+{
+	return false;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The current shader (the scalar one, whose images are the reference, until someone asks for a SIMD one)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	SpanShader		currentShader = SPAN_SCALAR;
+
+// The pixel format routines match the scalar loops exactly, so they're always the best ones supported
+
+static	SpanShader		currentPixelRoutines = bestSpanShader();
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	spanShaderSupported(const SpanShader shader)
+{
+	switch(shader)
+	{
+		case SPAN_SCALAR:	return true;
+		case SPAN_SSE2:		return spanShaderSSE2Built && processorSupports(SPAN_SSE2);
+		case SPAN_AVX2:		return spanShaderAVX2Built && processorSupports(SPAN_AVX2);
+		default:		return false;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+SpanShader	bestSpanShader()
+{
+	if (spanShaderSupported(SPAN_AVX2)) return SPAN_AVX2;
+	if (spanShaderSupported(SPAN_SSE2)) return SPAN_SSE2;
+	return SPAN_SCALAR;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	setSpanShader(const SpanShader shader)
+{
+	if (!spanShaderSupported(shader)) throw std::string("The ") + spanShaderName(shader) + " span shader isn't supported by this build/processor";
+
+	currentShader = shader;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+SpanShader	spanShader()
+{
+	return currentShader;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	setPixelRoutines(const SpanShader shader)
+{
+	if (!spanShaderSupported(shader)) throw std::string("The ") + spanShaderName(shader) + " pixel routines aren't supported by this build/processor";
+
+	currentPixelRoutines = shader;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+SpanShader	pixelRoutines()
+{
+	return currentPixelRoutines;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+SpanShaderFunction	spanShaderFunction(const unsigned int lightCount, const bool shadows)
+{
+	if (lightCount > maxSpanLights) return NULL;
+
+	switch(currentShader)
+	{
+		case SPAN_SSE2:	return spanShaderSSE2(lightCount, shadows);
+		case SPAN_AVX2:	return spanShaderAVX2(lightCount, shadows);
+		default:	return NULL;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+const char *	spanShaderName(const SpanShader shader)
+{
+	switch(shader)
+	{
+		case SPAN_SCALAR:	return "scalar";
+		case SPAN_SSE2:		return "sse2";
+		case SPAN_AVX2:		return "avx2";
+		default:		return "unknown";
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Span.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
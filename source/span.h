@@ -0,0 +1,192 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____                       _     
+//  / ____|                     | |    
+// | (___  _ __   __ _ _ __     | |__  
+//  \___ \| '_ \ / _` | '_ \    | '_ \ 
+//  ____) | |_) | (_| | | | | _ | | | |
+// |_____/| .__/ \__,_|_| |_|(_)|_| |_|
+//        | |                          
+//        |_|                          
+//
+// Description:
+//
+//   SIMD span shaders for drawPerspectiveTexturedPolygon()
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_SPAN
+#define _H_SPAN
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Module setup (required includes, macros, etc.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// This has no dependencies (the SIMD shaders are compiled with different instruction sets, so they don't share any inline code
+// with the rest of the program.) The lights and the span are flattened into these plain structures by the caller.
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The span shaders
+//
+// The scalar shader is the original per-pixel loop in drawPerspectiveTexturedPolygon(). The SIMD shaders shade 4 (SSE2) or 8
+// (AVX2) pixels at a time, with the interpolants stored as one vector per component. The depth test is done for all of the pixels
+// at once, a group of pixels that all fail it isn't shaded at all, and the results are only written for the pixels that passed.
+//
+// The SIMD shaders don't produce bit-identical results to the scalar shader (the interpolants are calculated from the start of the
+// span rather than stepped, and pow() is approximated) but the difference is far below what a 24-bit pixel can show.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+enum	SpanShader {SPAN_SCALAR, SPAN_SSE2, SPAN_AVX2, SPAN_SHADER_COUNT};
+
+// The most lights a SIMD shader can handle -- polygons lit by more lights than this are drawn with the scalar shader
+
+const	unsigned int	maxSpanLights = 32;
+
+// Each SIMD shader is specialized for every light count up to this (with and without shadows), so that the light loop is unrolled
+// and the per-light constants can be kept in registers. More lights than this use a general version that loops over them.
+
+const	unsigned int	specializedSpanLights = 4;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A light (and its shadow map.) The shadow map transform is stored just like a Matrix4 (column-major.) The shadow map is NULL when
+// the scene has no shadows.
+//
+// The last few members are derived from the others once per render (see setupSpanShader() in TMap.cpp) rather than recalculated
+// for every light at every pixel. They're the exact values the per-pixel code used to calculate, so the results don't change.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	float		pos[3];
+	float		dir[3];
+	float		color[3];
+	float		innerRange, outerRange;
+	float		hotspot, falloff;
+	const	float *	shadowMap;
+	int		shadowMapWidth;
+	int		shadowMapHeight;
+	float		shadowMapXform[16];
+	float		rangeDelta;		// outerRange - innerRange
+	float		spotDelta;		// hotspot - falloff
+	float		shadowMapHalf[2];	// Half of the shadow map's width & height
+	float		shadowMapScale[2];	// (half - 1) / half, for the width & height
+	float		shadowMapLimit[2];	// The last texel that can be filtered (width - 2, height - 3)
+} sSPANLIGHT;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Everything that's constant across a polygon
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	const	sSPANLIGHT *	lights;
+	unsigned int		lightCount;
+	bool			shadows;	// Do the lights have shadow maps?
+	float			ambient[3];	// ambientColor * Ka
+	float			specular[3];	// specularColor * Ks
+	float			Kd;
+	float			Sh;
+	float			shadowMapBias;
+	const	unsigned int *	textureBuffer;
+	unsigned int		textureWidth;
+	unsigned int		textureHeight;
+} sSHADER;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A single span: the interpolants at the first pixel and their per-pixel deltas, and the buffers starting at the first pixel (the
+// ID buffer, visible buffer, mask and accumulation buffer are optional, see drawPerspectiveTexturedPolygon())
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	float			texture[2], dtexture[2];
+	float			view[4], dview[4];
+	float			world[4], dworld[4];
+	float			normal[3], dnormal[3];
+	unsigned int *		frameBuffer;
+	float *			zBuffer;
+	int *			idBuffer;
+	const	int *		visible;
+	const	unsigned char *	mask;
+	unsigned int *		accumBuffer;
+	int			polygonID;
+	int			length;
+} sSPAN;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Adds the change in a pixel's color (from oldColor to newColor) to its accumulation buffer entry. This is static, so the SIMD
+// shaders get their own copies of it.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	inline	void	accumulatePixel(unsigned int * accum, const unsigned int oldColor, const unsigned int newColor)
+{
+	accum[0] += ((newColor >> 16) & 0xff) - ((oldColor >> 16) & 0xff);
+	accum[1] += ((newColor >>  8) & 0xff) - ((oldColor >>  8) & 0xff);
+	accum[2] += ((newColor      ) & 0xff) - ((oldColor      ) & 0xff);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Prototypes
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	unsigned int	(*SpanShaderFunction)(const sSPAN & span, const sSHADER & shader);
+
+// A shader function shades a span, returning the number of pixels that passed the depth test (and were shaded.) With a visible
+// buffer, the pixels that pass are the ones where the span's polygon is visible, rather than the ones nearer than the z-buffer.
+//
+// These return the version of their shader that's specialized for the given number of lights, with or without shadows (see
+// specializedSpanLights.)
+
+SpanShaderFunction	spanShaderSSE2(const unsigned int lightCount, const bool shadows);
+SpanShaderFunction	spanShaderAVX2(const unsigned int lightCount, const bool shadows);
+
+// Were the SIMD shaders compiled in? (They depend on the compiler, and the AVX2 shader needs its own compiler flags.)
+
+extern	const	bool	spanShaderSSE2Built;
+extern	const	bool	spanShaderAVX2Built;
+
+// Selects the span shader used by drawPerspectiveTexturedPolygon(). The default is the scalar shader, since the SIMD shaders' images
+// can differ from it by a shade here and there. Selecting one that isn't supported (see spanShaderSupported()) throws.
+
+void			setSpanShader(const SpanShader shader);
+SpanShader		spanShader();
+
+// Selects the versions of Render's pixel format routines (see Pixels.h), independently of the span shader. They produce exactly the
+// same results as the scalar loops, so the default is the best ones that the processor supports. Selecting ones that aren't
+// supported throws.
+
+void			setPixelRoutines(const SpanShader shader);
+SpanShader		pixelRoutines();
+
+// Returns the function for the current span shader, specialized for the given number of lights, with or without shadows (NULL for the
+// scalar shader, or if there are more than maxSpanLights lights.) This is meant to be called once per render, not per polygon.
+
+SpanShaderFunction	spanShaderFunction(const unsigned int lightCount, const bool shadows);
+
+// Does this build (and this processor) support the given shader?
+
+bool			spanShaderSupported(const SpanShader shader);
+
+// The best shader supported, and the shader names (as used on the command line)
+
+SpanShader		bestSpanShader();
+const	char *		spanShaderName(const SpanShader shader);
+
+#endif // _H_SPAN
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Span.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,148 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____                            __      ____   __ ___                       
+//  / ____|                      /\   \ \    / /\ \ / /|__ \                      
+// | (___  _ __   __ _ _ __     /  \   \ \  / /  \ V /    ) |     ___ _ __  _ __  
+//  \___ \| '_ \ / _` | '_ \   / /\ \   \ \/ /    > <    / /     / __| '_ \| '_ \ 
+//  ____) | |_) | (_| | | | | / ____ \   \  /    / . \  / /_  _ | (__| |_) | |_) |
+// |_____/| .__/ \__,_|_| |_|/_/    \_\   \/    /_/ \_\|____|(_) \___| .__/| .__/ 
+//        | |                                                        | |   | |    
+//        |_|                                                        |_|   |_|    
+//
+// Description:
+//
+//   The AVX2 span shader (see Span.h)
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+//   This is the only module compiled with AVX2 enabled (see the Makefile), and it's only ever called when the processor supports
+//   it. So it includes nothing but the span shader headers -- any inline code from elsewhere would be compiled with AVX2 here, and
+//   the linker is free to use that copy for the rest of the program.
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "span.h"
+#include "spansimd.h"
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define	HAVE_SPAN_AVX2
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The AVX2 vector types (see SpanSIMD.h)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifdef HAVE_SPAN_AVX2
+
+class	AVX2Int
+{
+public:
+	enum			{width = 8};
+
+inline				AVX2Int() {}
+inline				AVX2Int(const __m256i v) : _v(v) {}
+inline				AVX2Int(const int i) : _v(_mm256_set1_epi32(i)) {}
+
+static	inline	AVX2Int		load(const int * p)	{return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));}
+inline		void		store(int * p) const	{_mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _v);}
+
+inline		__m256i		v() const		{return _v;}
+
+private:
+		__m256i		_v;
+};
+
+class	AVX2Float
+{
+public:
+	enum			{width = 8};
+
+inline				AVX2Float() {}
+inline				AVX2Float(const __m256 v) : _v(v) {}
+inline				AVX2Float(const float f) : _v(_mm256_set1_ps(f)) {}
+
+static	inline	AVX2Float	load(const float * p)	{return _mm256_loadu_ps(p);}
+inline		void		store(float * p) const	{_mm256_storeu_ps(p, _v);}
+
+static	inline	AVX2Float	ramp()			{return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);}
+static	inline	AVX2Float	laneMask(const int bits)
+				{
+					__m256i	lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+					return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lanes), lanes));
+				}
+inline		int		bits() const		{return _mm256_movemask_ps(_v);}
+
+inline		__m256		v() const		{return _v;}
+
+// Avoid the AVX/SSE transition penalty back in the rest of the program
+
+static	inline	void		cleanup()		{_mm256_zeroupper();}
+
+private:
+		__m256		_v;
+};
+
+static	inline	AVX2Float	operator +(const AVX2Float & a, const AVX2Float & b)	{return _mm256_add_ps(a.v(), b.v());}
+static	inline	AVX2Float	operator -(const AVX2Float & a, const AVX2Float & b)	{return _mm256_sub_ps(a.v(), b.v());}
+static	inline	AVX2Float	operator *(const AVX2Float & a, const AVX2Float & b)	{return _mm256_mul_ps(a.v(), b.v());}
+static	inline	AVX2Float	operator /(const AVX2Float & a, const AVX2Float & b)	{return _mm256_div_ps(a.v(), b.v());}
+static	inline	AVX2Float	operator <(const AVX2Float & a, const AVX2Float & b)	{return _mm256_cmp_ps(a.v(), b.v(), _CMP_LT_OS);}
+static	inline	AVX2Float	operator <=(const AVX2Float & a, const AVX2Float & b)	{return _mm256_cmp_ps(a.v(), b.v(), _CMP_LE_OS);}
+static	inline	AVX2Float	operator >(const AVX2Float & a, const AVX2Float & b)	{return _mm256_cmp_ps(a.v(), b.v(), _CMP_GT_OS);}
+static	inline	AVX2Float	operator >=(const AVX2Float & a, const AVX2Float & b)	{return _mm256_cmp_ps(a.v(), b.v(), _CMP_GE_OS);}
+static	inline	AVX2Float	operator &(const AVX2Float & a, const AVX2Float & b)	{return _mm256_and_ps(a.v(), b.v());}
+static	inline	AVX2Float	operator |(const AVX2Float & a, const AVX2Float & b)	{return _mm256_or_ps(a.v(), b.v());}
+static	inline	AVX2Float	select(const AVX2Float & m, const AVX2Float & a, const AVX2Float & b)
+										{return _mm256_blendv_ps(b.v(), a.v(), m.v());}
+static	inline	AVX2Float	squareRoot(const AVX2Float & a)				{return _mm256_sqrt_ps(a.v());}
+static	inline	AVX2Float	minOf(const AVX2Float & a, const AVX2Float & b)		{return _mm256_min_ps(a.v(), b.v());}
+static	inline	AVX2Float	maxOf(const AVX2Float & a, const AVX2Float & b)		{return _mm256_max_ps(a.v(), b.v());}
+
+static	inline	AVX2Int		operator +(const AVX2Int & a, const AVX2Int & b)	{return _mm256_add_epi32(a.v(), b.v());}
+static	inline	AVX2Int		operator &(const AVX2Int & a, const AVX2Int & b)	{return _mm256_and_si256(a.v(), b.v());}
+static	inline	AVX2Int		operator |(const AVX2Int & a, const AVX2Int & b)	{return _mm256_or_si256(a.v(), b.v());}
+static	inline	AVX2Int		shiftLeft(const AVX2Int & a, const int n)		{return _mm256_sll_epi32(a.v(), _mm_cvtsi32_si128(n));}
+static	inline	AVX2Int		shiftRight(const AVX2Int & a, const int n)		{return _mm256_srl_epi32(a.v(), _mm_cvtsi32_si128(n));}
+
+static	inline	AVX2Int		truncate(const AVX2Float & a)				{return _mm256_cvttps_epi32(a.v());}
+static	inline	AVX2Int		roundToInt(const AVX2Float & a)				{return _mm256_cvtps_epi32(a.v());}
+static	inline	AVX2Float	toFloat(const AVX2Int & a)				{return _mm256_cvtepi32_ps(a.v());}
+static	inline	AVX2Int		floatToBits(const AVX2Float & a)			{return _mm256_castps_si256(a.v());}
+static	inline	AVX2Float	bitsToFloat(const AVX2Int & a)				{return _mm256_castsi256_ps(a.v());}
+static	inline	AVX2Float	gather(const float * p, const AVX2Int & index, const AVX2Float & mask)
+										{return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), p, index.v(), mask.v(), 4);}
+
+SpanShaderFunction	spanShaderAVX2(const unsigned int lightCount, const bool shadows)
+{
+	return selectSpanKernel<AVX2Float, AVX2Int>(lightCount, shadows);
+}
+
+const	bool	spanShaderAVX2Built = true;
+
+#else
+
+SpanShaderFunction	spanShaderAVX2(const unsigned int lightCount, const bool shadows)
+{
+	return NULL;
+}
+
+const	bool	spanShaderAVX2Built = false;
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// SpanAVX2.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,420 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____                    _____ _____ __  __ _____     _     
+//  / ____|                  / ____|_   _|  \/  |  __ \   | |    
+// | (___  _ __   __ _ _ __ | (___   | | | \  / | |  | |  | |__  
+//  \___ \| '_ \ / _` | '_ \ \___ \  | | | |\/| | |  | |  | '_ \ 
+//  ____) | |_) | (_| | | | |____) |_| |_| |  | | |__| |_ | | | |
+// |_____/| .__/ \__,_|_| |_|_____/|_____|_|  |_|_____/(_)|_| |_|
+//        | |                                                    
+//        |_|                                                    
+//
+// Description:
+//
+//   The SIMD span shader, written once for any vector width (see Span.cpp and SpanAVX2.cpp)
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+//   Only include this from the span shader modules. Everything here is a template over the vector types, so each module gets its
+//   own copy, compiled for its own instruction set. For the same reason, this must not use anything (vmath, the STL, etc.) that
+//   has inline code shared with the rest of the program.
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_SPANSIMD
+#define _H_SPANSIMD
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Module setup (required includes, macros, etc.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "span.h"
+#include <cfloat>
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The vector types
+//
+// F is a vector of floats and I is a vector of 32-bit ints, both F::width wide. Comparisons produce masks (all bits set in the
+// lanes where they're true) which are combined with the bitwise operators. Each module provides these for its vector types:
+//
+//	F(float)				Broadcast
+//	F::load(p), f.store(p)			Unaligned load/store
+//	F::ramp()				The lane indices (0, 1, 2, ...)
+//	F::laneMask(bits)			A mask from the low F::width bits of an int (bit n is lane n)
+//	f.bits()				The sign bit of each lane (i.e. the opposite of laneMask)
+//	+ - * / on F, + & | on I		Lane-wise arithmetic
+//	< <= > >= on F, & | on F		Comparisons & masks
+//	select(mask, a, b)			a where the mask is set, otherwise b
+//	squareRoot, minOf, maxOf		Lane-wise
+//	truncate(f), roundToInt(f)		F -> I (truncated, or rounded to nearest)
+//	toFloat(i)				I -> F
+//	floatToBits(f), bitsToFloat(i)		Reinterpret the bits
+//	shiftLeft(i, n), shiftRight(i, n)	Logical shifts
+//	gather(p, i, mask)			p[i] for the lanes where the mask is set, otherwise 0
+//	F::cleanup()				Called on the way out of a shader (to leave the registers in a state that's cheap for
+//						the rest of the program)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// log2(x) for x > 0
+//
+// The mantissa is reduced to [sqrt(1/2), sqrt(2)] and ln(m) = 2 * atanh((m-1)/(m+1)) is summed to the t^9 term, which is accurate to
+// within a few ulps over that range.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+template<class F, class I>
+inline	F	spanLog2(const F & x)
+{
+	I	bits = floatToBits(x);
+	F	e = toFloat(shiftRight(bits, 23)) - F(127.0f);
+	F	m = bitsToFloat((bits & I(0x007fffff)) | I(0x3f800000));
+
+	F	big = m > F(1.41421356f);
+	m = select(big, m * F(0.5f), m);
+	e = select(big, e + F(1.0f), e);
+
+	F	t = (m - F(1.0f)) / (m + F(1.0f));
+	F	t2 = t * t;
+	F	series = F(1.0f / 9.0f);
+	series = series * t2 + F(1.0f / 7.0f);
+	series = series * t2 + F(1.0f / 5.0f);
+	series = series * t2 + F(1.0f / 3.0f);
+	series = series * t2 + F(1.0f);
+
+	// 2 / ln(2)
+
+	return e + t * series * F(2.88539008f);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// 2^x
+//
+// Split into an integer power (built directly into the exponent bits) and a remainder in [-0.5, 0.5], for which e^(r*ln(2)) is
+// summed to the 7th degree.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+template<class F, class I>
+inline	F	spanExp2(const F & x)
+{
+	F	y = minOf(maxOf(x, F(-126.0f)), F(127.0f));
+	I	n = roundToInt(y);
+	F	r = (y - toFloat(n)) * F(0.693147181f);
+
+	F	series = F(1.0f / 5040.0f);
+	series = series * r + F(1.0f / 720.0f);
+	series = series * r + F(1.0f / 120.0f);
+	series = series * r + F(1.0f / 24.0f);
+	series = series * r + F(1.0f / 6.0f);
+	series = series * r + F(0.5f);
+	series = series * r + F(1.0f);
+	series = series * r + F(1.0f);
+
+	return series * bitsToFloat(shiftLeft(n + I(127), 23));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Shades a span, F::width pixels at a time. This mirrors shade() and lightTerms() in TMap.cpp, step for step.
+//
+// The kernel is specialized for the number of lights (lightCount, or anyLightCount for the general version, which uses the
+// shader's light count) and for whether or not there are shadows. With a fixed light count, the light loop is unrolled and the
+// lights' constants don't have to be reloaded for every group of pixels. Without shadows, the whole shadow map lookup goes away.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+const	int	anyLightCount = -1;
+
+template<class F, class I, int lightCount, bool shadows>
+unsigned int	shadeSpanKernel(const sSPAN & span, const sSHADER & shader)
+{
+	const	int	width = F::width;
+	const	unsigned int	lights = lightCount == anyLightCount ? shader.lightCount : static_cast<unsigned int>(lightCount);
+	unsigned int	shaded = 0;
+
+	for (int i = 0; i < span.length; i += width)
+	{
+		int	count = span.length - i;
+		if (count > width) count = width;
+
+		// The depth test (the lanes past the end of the span can never pass)
+
+		F	index = F(static_cast<float>(i)) + F::ramp();
+		F	vw = F(span.view[3]) + index * F(span.dview[3]);
+		F	z;
+
+		if (count == width)
+		{
+			z = F::load(span.zBuffer + i);
+		}
+		else
+		{
+			float	tail[width];
+			for (int j = 0; j < width; ++j) tail[j] = j < count ? span.zBuffer[i+j] : FLT_MAX;
+			z = F::load(tail);
+		}
+
+		F	pass = vw > z;
+
+		// After a depth pre-pass, the pixels to shade are simply the ones where this polygon is visible
+
+		if (span.visible)
+		{
+			int	bits = 0;
+			for (int j = 0; j < count; ++j) if (span.visible[i+j] == span.polygonID) bits |= 1 << j;
+			pass = F::laneMask(bits);
+		}
+
+		if (span.mask)
+		{
+			int	bits = 0;
+			for (int j = 0; j < count; ++j) if (span.mask[i+j]) bits |= 1 << j;
+			pass = pass & F::laneMask(bits);
+		}
+
+		int	passBits = pass.bits();
+		if (!passBits) continue;
+
+		// Perspective divide
+
+		F	oz = F(1.0f) / vw;
+		F	tx = (F(span.texture[0]) + index * F(span.dtexture[0])) * oz;
+		F	ty = (F(span.texture[1]) + index * F(span.dtexture[1])) * oz;
+
+		F	nx = (F(span.normal[0]) + index * F(span.dnormal[0])) * oz;
+		F	ny = (F(span.normal[1]) + index * F(span.dnormal[1])) * oz;
+		F	nz = (F(span.normal[2]) + index * F(span.dnormal[2])) * oz;
+		F	nScale = F(1.0f) / squareRoot(nx*nx + ny*ny + nz*nz);
+		nx = nx * nScale;
+		ny = ny * nScale;
+		nz = nz * nScale;
+
+		F	wx = (F(span.world[0]) + index * F(span.dworld[0])) * oz;
+		F	wy = (F(span.world[1]) + index * F(span.dworld[1])) * oz;
+		F	wz = (F(span.world[2]) + index * F(span.dworld[2])) * oz;
+		F	ww = (F(span.world[3]) + index * F(span.dworld[3])) * oz;
+
+		// Vector that points to the camera
+
+		F	vx = F(0.0f) - (F(span.view[0]) + index * F(span.dview[0])) * oz;
+		F	vy = F(0.0f) - (F(span.view[1]) + index * F(span.dview[1])) * oz;
+		F	vz = F(0.0f) - (F(span.view[2]) + index * F(span.dview[2])) * oz;
+		F	vScale = F(1.0f) / squareRoot(vx*vx + vy*vy + vz*vz);
+		vx = vx * vScale;
+		vy = vy * vScale;
+		vz = vz * vScale;
+
+		// Texel fetch (scalar -- the texture coordinates wrap, so the addresses are all over the place)
+
+		float	s[width], t[width];
+		int	texels[width];
+		tx.store(s);
+		ty.store(t);
+		for (int j = 0; j < width; ++j)
+		{
+			if (!(passBits & (1 << j))) {texels[j] = 0; continue;}
+			unsigned int	ts = static_cast<unsigned int>(static_cast<int>(s[j])) % shader.textureWidth;
+			unsigned int	tt = static_cast<unsigned int>(static_cast<int>(t[j])) % shader.textureHeight;
+			texels[j] = static_cast<int>(shader.textureBuffer[tt * shader.textureWidth + ts]);
+		}
+		I	texel = I::load(texels);
+		F	dr = toFloat(shiftRight(texel, 16) & I(0xff)) / F(255.0f);
+		F	dg = toFloat(shiftRight(texel,  8) & I(0xff)) / F(255.0f);
+		F	db = toFloat(texel & I(0xff)) / F(255.0f);
+
+		// Start with ambient
+
+		F	diffuseR = F(shader.ambient[0]), diffuseG = F(shader.ambient[1]), diffuseB = F(shader.ambient[2]);
+		F	specularR = F(0.0f), specularG = F(0.0f), specularB = F(0.0f);
+
+		for (unsigned int l = 0; l < lights; ++l)
+		{
+			const sSPANLIGHT &	light = shader.lights[l];
+
+			F	lx = F(light.pos[0]) - wx;
+			F	ly = F(light.pos[1]) - wy;
+			F	lz = F(light.pos[2]) - wz;
+			F	active = pass & (nx*lx + ny*ly + nz*lz >= F(0.0f));
+
+			// Distance to the light source (and beyond its outer range?)
+
+			F	lLength = squareRoot(lx*lx + ly*ly + lz*lz);
+			active = active & (lLength <= F(light.outerRange));
+			if (!active.bits()) continue;
+
+			lx = lx / lLength;
+			ly = ly / lLength;
+			lz = lz / lLength;
+
+			// Spotlight hotspot/falloff
+
+			F	diffuseScalar = F(0.0f) - (lx * F(light.dir[0]) + ly * F(light.dir[1]) + lz * F(light.dir[2]));
+			diffuseScalar = select(diffuseScalar < F(light.falloff), F(0.0f),
+					select(diffuseScalar > F(light.hotspot), F(1.0f),
+					(diffuseScalar - F(light.falloff)) / F(light.spotDelta)));
+
+			// Shadow (the shadow map transform is column-major)
+
+			F	shadowPercent = F(1.0f);
+			if (shadows)
+			{
+				const float *	m = light.shadowMapXform;
+				F	px = F(0.0f) + F(m[ 0]) * wx + F(m[ 1]) * wy + F(m[ 2]) * wz + F(m[ 3]) * ww;
+				F	py = F(0.0f) + F(m[ 4]) * wx + F(m[ 5]) * wy + F(m[ 6]) * wz + F(m[ 7]) * ww;
+				F	pw = F(0.0f) + F(m[12]) * wx + F(m[13]) * wy + F(m[14]) * wz + F(m[15]) * ww;
+				F	ow = F(1.0f) / pw;
+
+				F	smx = toFloat(truncate(F(light.shadowMapHalf[0]) + px * ow * F(light.shadowMapHalf[0]) * F(light.shadowMapScale[0])));
+				F	smy = toFloat(truncate(F(light.shadowMapHalf[1]) - py * ow * F(light.shadowMapHalf[1]) * F(light.shadowMapScale[1])));
+				active = active & (smx >= F(1.0f)) & (smx <= F(light.shadowMapLimit[0]));
+				active = active & (smy >= F(1.0f)) & (smy <= F(light.shadowMapLimit[1]));
+				if (!active.bits()) continue;
+
+				// Filtering (the index is exact in a float for any shadow map under 16M texels.) Like lightTerms(), this
+				// filters the row of the texel and the two rows below it.
+
+				I	smIndex = truncate(smy * F(static_cast<float>(light.shadowMapWidth)) + smx);
+				F	bias = F(shader.shadowMapBias);
+				F	visible = F(0.0f);
+				for (int dy = 0; dy <= 2; ++dy)
+				{
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						F	lw = gather(light.shadowMap, smIndex + I(dy * light.shadowMapWidth + dx), active);
+						F	covered = lw > F(0.0f);
+						F	safe = select(covered, lw, F(1.0f));
+						visible = visible + (covered & (pw <= F(1.0f) / safe + bias) & F(1.0f));
+					}
+				}
+				active = active & (visible > F(0.0f));
+				if (!active.bits()) continue;
+
+				shadowPercent = visible / F(9.0f);
+			}
+
+			F	NdotL = nx*lx + ny*ly + nz*lz;
+
+			// Attenuation
+
+			F	attenuation = select(lLength > F(light.innerRange), F(1.0f) - (lLength - F(light.innerRange)) / F(light.rangeDelta), F(1.0f));
+
+			// Reflection vector for specular
+
+			F	twoNdotL = NdotL * F(2.0f);
+			F	RdotV = (nx*twoNdotL - lx) * vx + (ny*twoNdotL - ly) * vy + (nz*twoNdotL - lz) * vz;
+			F	lit = RdotV > F(0.0f);
+			F	specular = lit & spanExp2<F, I>(F(shader.Sh) * spanLog2<F, I>(select(lit, RdotV, F(1.0f))));
+
+			// The Phong equation (only for the lanes that this light reaches)
+
+			F	lightScale = active & (attenuation * shadowPercent);
+			F	lr = F(light.color[0]) * lightScale;
+			F	lg = F(light.color[1]) * lightScale;
+			F	lb = F(light.color[2]) * lightScale;
+			F	diffuse = F(shader.Kd) * NdotL * diffuseScalar;
+			diffuseR = diffuseR + lr * diffuse;
+			diffuseG = diffuseG + lg * diffuse;
+			diffuseB = diffuseB + lb * diffuse;
+			specularR = specularR + lr * F(shader.specular[0]) * specular;
+			specularG = specularG + lg * F(shader.specular[1]) * specular;
+			specularB = specularB + lb * F(shader.specular[2]) * specular;
+		}
+
+		// Clamp & pack (NaNs end up as 0, just like the scalar conversion)
+
+		I	r = truncate(minOf(maxOf((dr * diffuseR + specularR) * F(255.0f), F(0.0f)), F(255.0f)));
+		I	g = truncate(minOf(maxOf((dg * diffuseG + specularG) * F(255.0f), F(0.0f)), F(255.0f)));
+		I	b = truncate(minOf(maxOf((db * diffuseB + specularB) * F(255.0f), F(0.0f)), F(255.0f)));
+		I	color = shiftLeft(r, 16) | shiftLeft(g, 8) | b;
+
+		// Accumulate the pixels that passed (before they're overwritten)
+
+		if (span.accumBuffer)
+		{
+			int	colors[width];
+			color.store(colors);
+			for (int j = 0; j < count; ++j)
+			{
+				if (passBits & (1 << j)) accumulatePixel(span.accumBuffer + (i+j) * 3, span.frameBuffer[i+j], static_cast<unsigned int>(colors[j]));
+			}
+		}
+
+		// Write the pixels that passed
+
+		if (count == width)
+		{
+			unsigned int *	fb = span.frameBuffer + i;
+			float *		zb = span.zBuffer + i;
+			select(pass, bitsToFloat(color), F::load(reinterpret_cast<float *>(fb))).store(reinterpret_cast<float *>(fb));
+			select(pass, vw, z).store(zb);
+		}
+		else
+		{
+			int	colors[width];
+			float	depths[width];
+			color.store(colors);
+			vw.store(depths);
+			for (int j = 0; j < count; ++j)
+			{
+				if (!(passBits & (1 << j))) continue;
+				span.frameBuffer[i+j] = static_cast<unsigned int>(colors[j]);
+				span.zBuffer[i+j] = depths[j];
+			}
+		}
+
+		if (span.idBuffer)
+		{
+			for (int j = 0; j < count; ++j) if (passBits & (1 << j)) span.idBuffer[i+j] = span.polygonID;
+		}
+
+		for (int j = 0; j < count; ++j) if (passBits & (1 << j)) ++shaded;
+	}
+
+	F::cleanup();
+	return shaded;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Picks the version of the kernel for the given number of lights, with or without shadows (see specializedSpanLights in Span.h)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+template<class F, class I>
+SpanShaderFunction	selectSpanKernel(const unsigned int lightCount, const bool shadows)
+{
+	if (shadows)
+	{
+		switch(lightCount)
+		{
+			case 0:	return shadeSpanKernel<F, I, 0, true>;
+			case 1:	return shadeSpanKernel<F, I, 1, true>;
+			case 2:	return shadeSpanKernel<F, I, 2, true>;
+			case 3:	return shadeSpanKernel<F, I, 3, true>;
+			case 4:	return shadeSpanKernel<F, I, 4, true>;
+			default:return shadeSpanKernel<F, I, anyLightCount, true>;
+		}
+	}
+
+	switch(lightCount)
+	{
+		case 0:	return shadeSpanKernel<F, I, 0, false>;
+		case 1:	return shadeSpanKernel<F, I, 1, false>;
+		case 2:	return shadeSpanKernel<F, I, 2, false>;
+		case 3:	return shadeSpanKernel<F, I, 3, false>;
+		case 4:	return shadeSpanKernel<F, I, 4, false>;
+		default:return shadeSpanKernel<F, I, anyLightCount, false>;
+	}
+}
+
+#endif // _H_SPANSIMD
+// ---------------------------------------------------------------------------------------------------------------------------------
+// SpanSIMD.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,311 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____ _        _                            
+//  / ____| |      | |                           
+// | (___ | |_ __ _| |_ ___      ___ _ __  _ __  
+//  \___ \| __/ _` | __/ __|    / __| '_ \| '_ \ 
+//  ____) | || (_| | |_\__ \ _ | (__| |_) | |_) |
+// |_____/ \__\__,_|\__|___/(_) \___| .__/| .__/ 
+//                                  | |   | |    
+//                                  |_|   |_|    
+//
+// Description:
+//
+//   Timing and counters for the render stages (see --stats)
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "texturebin.h"
+#include "stats.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	Stats::Stats()
+{
+	reset();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	Stats::~Stats()
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Stats::reset()
+{
+	name().erase();
+	files() = 0;
+
+	for (unsigned int i = 0; i < STAGE_COUNT; ++i)
+	{
+		_timed[i] = 0;
+		_wall[i] = 0;
+		_cpu[i] = 0;
+		_wallStart[i] = 0;
+		_cpuStart[i] = 0;
+	}
+
+	verticesWelded() = 0;
+	polygonsTransformed() = 0;
+	polygonsCulled() = 0;
+	polygonsRejected() = 0;
+	meshesTested() = 0;
+	meshesCulled() = 0;
+	polygonsMeshCulled() = 0;
+	bvhNodesTested() = 0;
+	bvhNodesCulled() = 0;
+	polygonsBvhCulled() = 0;
+	polygonsClipped() = 0;
+	polygonsEmitted() = 0;
+	passes() = 0;
+	pixels() = 0;
+	pixelsTested() = 0;
+	pixelsShaded() = 0;
+	prepassPixels() = 0;
+	shadowTexels() = 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Stats::begin(const Stage stage)
+{
+	_wallStart[stage] = wallTime();
+	_cpuStart[stage] = cpuTime();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Stats::end(const Stage stage)
+{
+	wall(stage) += wallTime() - _wallStart[stage];
+	cpu(stage) += cpuTime() - _cpuStart[stage];
+	++_timed[stage];
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	Stats::add(const Stats & rhs)
+{
+	files() += rhs.files();
+
+	for (unsigned int i = 0; i < STAGE_TOTAL; ++i)
+	{
+		_timed[i] += rhs._timed[i];
+		_wall[i] += rhs._wall[i];
+		_cpu[i] += rhs._cpu[i];
+	}
+
+	verticesWelded() += rhs.verticesWelded();
+	polygonsTransformed() += rhs.polygonsTransformed();
+	polygonsCulled() += rhs.polygonsCulled();
+	polygonsRejected() += rhs.polygonsRejected();
+	meshesTested() += rhs.meshesTested();
+	meshesCulled() += rhs.meshesCulled();
+	polygonsMeshCulled() += rhs.polygonsMeshCulled();
+	bvhNodesTested() += rhs.bvhNodesTested();
+	bvhNodesCulled() += rhs.bvhNodesCulled();
+	polygonsBvhCulled() += rhs.polygonsBvhCulled();
+	polygonsClipped() += rhs.polygonsClipped();
+	polygonsEmitted() += rhs.polygonsEmitted();
+	passes() += rhs.passes();
+	pixels() += rhs.pixels();
+	pixelsTested() += rhs.pixelsTested();
+	pixelsShaded() += rhs.pixelsShaded();
+	prepassPixels() += rhs.prepassPixels();
+	shadowTexels() += rhs.shadowTexels();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+std::string	Stats::report(const bool json) const
+{
+	std::string	result;
+	char		str[256];
+	double		overdraw = pixels() ? pixelsShaded() / pixels() : 0;
+
+	if (json)
+	{
+		// The name may be a path, so escape it
+
+		result = "{\"name\":\"";
+		for (unsigned int i = 0; i < name().length(); ++i)
+		{
+			if (name()[i] == '\\' || name()[i] == '"') result += '\\';
+			result += name()[i];
+		}
+		sprintf(str, "\",\"files\":%d,\"stages\":{", files());
+		result += str;
+
+		bool	first = true;
+		for (unsigned int i = 0; i < STAGE_COUNT; ++i)
+		{
+			if (!_timed[i]) continue;
+			sprintf(str, "%s\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}", first ? "":",", stageName(static_cast<Stage>(i)), _wall[i], _cpu[i]);
+			result += str;
+			first = false;
+		}
+
+		sprintf(str, "},\"polygons\":{\"transformed\":%.0f,\"culled\":%.0f,\"rejected\":%.0f,\"clipped\":%.0f,\"emitted\":%.0f}", polygonsTransformed(), polygonsCulled(), polygonsRejected(), polygonsClipped(), polygonsEmitted());
+		result += str;
+		sprintf(str, ",\"meshes\":{\"tested\":%.0f,\"culled\":%.0f,\"culledPolygons\":%.0f}", meshesTested(), meshesCulled(), polygonsMeshCulled());
+		result += str;
+		sprintf(str, ",\"bvh\":{\"tested\":%.0f,\"culled\":%.0f,\"culledPolygons\":%.0f}", bvhNodesTested(), bvhNodesCulled(), polygonsBvhCulled());
+		result += str;
+		sprintf(str, ",\"pixels\":{\"passes\":%.0f,\"tested\":%.0f,\"shaded\":%.0f,\"overdraw\":%.4f,\"prepass\":%.0f}", passes(), pixelsTested(), pixelsShaded(), overdraw, prepassPixels());
+		result += str;
+		sprintf(str, ",\"verticesWelded\":%.0f,\"shadowTexels\":%.0f}", verticesWelded(), shadowTexels());
+		result += str;
+		return result;
+	}
+
+	// Times
+
+	result = name() + ":";
+	bool	first = true;
+	for (unsigned int i = 0; i < STAGE_COUNT; ++i)
+	{
+		if (!_timed[i]) continue;
+		sprintf(str, "%s %s %.1fms (cpu %.1fms)", first ? "":",", stageName(static_cast<Stage>(i)), _wall[i] * 1000, _cpu[i] * 1000);
+		result += str;
+		first = false;
+	}
+
+	if (files() > 1 && _timed[STAGE_TOTAL] && wall(STAGE_TOTAL) > 0)
+	{
+		sprintf(str, ", %d files (%.2f per second)", files(), files() / wall(STAGE_TOTAL));
+		result += str;
+	}
+	result += "\n";
+
+	// Counters (only the ones that apply)
+
+	if (verticesWelded())
+	{
+		sprintf(str, "    import: %.0f vertices welded\n", verticesWelded());
+		result += str;
+	}
+
+	if (meshesTested())
+	{
+		sprintf(str, "    meshes: %.0f tested, %.0f culled (%.0f polygons not transformed)\n", meshesTested(), meshesCulled(), polygonsMeshCulled());
+		result += str;
+	}
+
+	if (bvhNodesTested())
+	{
+		sprintf(str, "    bvh: %.0f nodes tested, %.0f culled (%.0f polygons not transformed)\n", bvhNodesTested(), bvhNodesCulled(), polygonsBvhCulled());
+		result += str;
+	}
+
+	if (polygonsTransformed())
+	{
+		sprintf(str, "    polygons: %.0f transformed, %.0f culled, %.0f rejected, %.0f clipped, %.0f emitted\n", polygonsTransformed(), polygonsCulled(), polygonsRejected(), polygonsClipped(), polygonsEmitted());
+		result += str;
+	}
+
+	if (passes())
+	{
+		sprintf(str, "    pixels: %.0f passes, %.0f tested, %.0f shaded, %.2f overdraw per pass\n", passes(), pixelsTested(), pixelsShaded(), overdraw);
+		result += str;
+	}
+
+	if (prepassPixels())
+	{
+		sprintf(str, "    depth pre-pass: %.0f pixels passed, %.0f shaded (%.0f shades saved)\n", prepassPixels(), pixelsShaded(), prepassPixels() - pixelsShaded());
+		result += str;
+	}
+
+	if (shadowTexels())
+	{
+		sprintf(str, "    shadow maps: %.0f texels written\n", shadowTexels());
+		result += str;
+	}
+
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+const char *	Stats::stageName(const Stage stage)
+{
+	switch(stage)
+	{
+		case STAGE_IMPORT:	return "import";
+		case STAGE_SHADOWS:	return "shadows";
+		case STAGE_READ:	return "read";
+		case STAGE_TRANSFORM:	return "transform";
+		case STAGE_LIGHTING:	return "lighting";
+		case STAGE_RENDER:	return "render";
+		case STAGE_WRITE:	return "write";
+		case STAGE_TOTAL:	return "total";
+		default:		return "unknown";
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+double	Stats::wallTime()
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER	frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+#else
+	struct timeval	tv;
+	gettimeofday(&tv, NULL);
+	return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1000000.0;
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+double	Stats::cpuTime()
+{
+#ifdef _MSC_VER
+	FILETIME	creationTime, exitTime, kernelTime, userTime;
+	GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+
+	ULARGE_INTEGER	kernel, user;
+	kernel.LowPart = kernelTime.dwLowDateTime;
+	kernel.HighPart = kernelTime.dwHighDateTime;
+	user.LowPart = userTime.dwLowDateTime;
+	user.HighPart = userTime.dwHighDateTime;
+
+	// 100ns units
+
+	return static_cast<double>(kernel.QuadPart + user.QuadPart) / 10000000.0;
+#else
+	struct rusage	usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return	static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+		static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Stats.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,172 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   _____ _        _           _     
+//  / ____| |      | |         | |    
+// | (___ | |_ __ _| |_ ___    | |__  
+//  \___ \| __/ _` | __/ __|   | '_ \ 
+//  ____) | || (_| | |_\__ \ _ | | | |
+// |_____/ \__\__,_|\__|___/(_)|_| |_|
+//                                    
+//                                    
+//
+// Description:
+//
+//   Timing and counters for the render stages (see --stats)
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_STATS
+#define _H_STATS
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The statistics for a single render (or the scene, or a whole batch.) Counters are doubles, since they can easily overflow 32
+// bits over a batch.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	Stats
+{
+public:
+	// The stages that are timed. The total is the time from the start of the first stage to the end of the last.
+
+	enum	Stage {STAGE_IMPORT, STAGE_SHADOWS, STAGE_READ, STAGE_TRANSFORM, STAGE_LIGHTING, STAGE_RENDER, STAGE_WRITE, STAGE_TOTAL, STAGE_COUNT};
+
+	// Construction/Destruction
+
+					Stats();
+virtual					~Stats();
+
+	// Implementation
+
+virtual		void			reset();
+
+	// Times a stage. The CPU time is for the whole process (all threads) so it includes anything else that was running
+	// during the stage.
+
+virtual		void			begin(const Stage stage);
+virtual		void			end(const Stage stage);
+
+	// Adds another set of statistics to these (for a batch summary.) The total time isn't added, since the files of a
+	// batch overlap.
+
+virtual		void			add(const Stats & rhs);
+
+	// Returns the report, either human-readable (possibly several lines) or JSON (a single line, with no trailing newline)
+
+virtual		std::string		report(const bool json) const;
+
+	// Statics
+
+static		const char *		stageName(const Stage stage);
+static		double			wallTime();
+static		double			cpuTime();
+
+	// Accessors
+
+inline		std::string &		name()				{return _name;}
+inline	const	std::string		name() const			{return _name;}
+inline		unsigned int &		files()				{return _files;}
+inline	const	unsigned int		files() const			{return _files;}
+inline		double &		wall(const Stage stage)		{return _wall[stage];}
+inline	const	double			wall(const Stage stage) const	{return _wall[stage];}
+inline		double &		cpu(const Stage stage)		{return _cpu[stage];}
+inline	const	double			cpu(const Stage stage) const	{return _cpu[stage];}
+inline		double &		verticesWelded()		{return _verticesWelded;}
+inline	const	double			verticesWelded() const		{return _verticesWelded;}
+inline		double &		meshesTested()			{return _meshesTested;}
+inline	const	double			meshesTested() const		{return _meshesTested;}
+inline		double &		meshesCulled()			{return _meshesCulled;}
+inline	const	double			meshesCulled() const		{return _meshesCulled;}
+inline		double &		polygonsMeshCulled()		{return _polygonsMeshCulled;}
+inline	const	double			polygonsMeshCulled() const	{return _polygonsMeshCulled;}
+inline		double &		bvhNodesTested()		{return _bvhNodesTested;}
+inline	const	double			bvhNodesTested() const		{return _bvhNodesTested;}
+inline		double &		bvhNodesCulled()		{return _bvhNodesCulled;}
+inline	const	double			bvhNodesCulled() const		{return _bvhNodesCulled;}
+inline		double &		polygonsBvhCulled()		{return _polygonsBvhCulled;}
+inline	const	double			polygonsBvhCulled() const	{return _polygonsBvhCulled;}
+inline		double &		polygonsTransformed()		{return _polygonsTransformed;}
+inline	const	double			polygonsTransformed() const	{return _polygonsTransformed;}
+inline		double &		polygonsCulled()		{return _polygonsCulled;}
+inline	const	double			polygonsCulled() const		{return _polygonsCulled;}
+inline		double &		polygonsRejected()		{return _polygonsRejected;}
+inline	const	double			polygonsRejected() const	{return _polygonsRejected;}
+inline		double &		polygonsClipped()		{return _polygonsClipped;}
+inline	const	double			polygonsClipped() const		{return _polygonsClipped;}
+inline		double &		polygonsEmitted()		{return _polygonsEmitted;}
+inline	const	double			polygonsEmitted() const		{return _polygonsEmitted;}
+inline		double &		passes()			{return _passes;}
+inline	const	double			passes() const			{return _passes;}
+inline		double &		pixels()			{return _pixels;}
+inline	const	double			pixels() const			{return _pixels;}
+inline		double &		pixelsTested()			{return _pixelsTested;}
+inline	const	double			pixelsTested() const		{return _pixelsTested;}
+inline		double &		pixelsShaded()			{return _pixelsShaded;}
+inline	const	double			pixelsShaded() const		{return _pixelsShaded;}
+inline		double &		prepassPixels()			{return _prepassPixels;}
+inline	const	double			prepassPixels() const		{return _prepassPixels;}
+inline		double &		shadowTexels()			{return _shadowTexels;}
+inline	const	double			shadowTexels() const		{return _shadowTexels;}
+
+private:
+	// Data members
+
+		std::string		_name;
+		unsigned int		_files;
+		unsigned int		_timed[STAGE_COUNT];	// How many times each stage was timed
+		double			_wall[STAGE_COUNT];
+		double			_cpu[STAGE_COUNT];
+		double			_wallStart[STAGE_COUNT];
+		double			_cpuStart[STAGE_COUNT];
+		double			_verticesWelded;	// Vertices welded on import
+		double			_meshesTested;		// Meshes given to transformAndClip()
+		double			_meshesCulled;		// ...entirely outside the view volume
+		double			_polygonsMeshCulled;	// Polygons in those meshes (never transformed)
+		double			_bvhNodesTested;	// BVH nodes tested instead (see Bvh.h)
+		double			_bvhNodesCulled;	// ...entirely outside the view volume
+		double			_polygonsBvhCulled;	// Polygons under those nodes (never transformed)
+		double			_polygonsTransformed;	// Polygons transformed by transformAndClip()
+		double			_polygonsCulled;	// ...back-face culled
+		double			_polygonsRejected;	// ...trivially rejected (completely off-screen)
+		double			_polygonsClipped;	// ...partially off-screen (and clipped)
+		double			_polygonsEmitted;	// ...and sent on to the rasterizer
+		double			_passes;		// Oversample renders
+		double			_pixels;		// Frame buffer pixels, over all passes (for the overdraw)
+		double			_pixelsTested;		// Pixels (or subsamples, when multisampling) that were depth tested
+		double			_pixelsShaded;		// Pixels that passed the depth test and were shaded
+		double			_prepassPixels;		// Pixels that passed the depth pre-pass's test (shaded, without one)
+		double			_shadowTexels;		// Shadow map texels written
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Times a stage for as long as it's in scope (stats may be NULL, in which case it does nothing)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	StageTimer
+{
+public:
+					StageTimer(Stats * stats, const Stats::Stage stage) : _stats(stats), _stage(stage) {if (_stats) _stats->begin(_stage);}
+					~StageTimer() {if (_stats) _stats->end(_stage);}
+
+private:
+		Stats *			_stats;
+		Stats::Stage		_stage;
+};
+
+#endif // _H_STATS
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Stats.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
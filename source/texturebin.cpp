@@ -30,7 +30,11 @@
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 #include "texturebin.h"
+#include "jpeg.h"
 #include "render.h"
+#include "scene.h"
+#include "span.h"
+#include "stats.h"
 #include "tmap.h"
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -48,6 +52,8 @@ static	const	unsigned int	defaultRenderWidth = 400;
 static	const	unsigned int	defaultRenderHeight = 300;
 static	const	unsigned int	defaultOversampleX = 4;
 static	const	unsigned int	defaultOversampleY = 4;
+static	const	unsigned int	defaultThreadCount = 1;
+static	const	unsigned int	defaultBatchCount = 1;
 static	const	float		defaultKa = 0.1f;
 static	const	float		defaultKd = 1;
 static	const	float		defaultKs = 0.7f;
@@ -77,8 +83,13 @@ static	void	printUsage(const char * argv0)
 #endif
 
 	fprintf(stderr, "Usage: %s [options] <input specification [...]>\n", programName);
+	fprintf(stderr, "       -aNNN antialiasing mode: 'ss' supersample, 'ms' multisample, 'ad' adaptive\n");
+	fprintf(stderr, "             supersample (default = ss)\n");
+	fprintf(stderr, "       -bNNN render NNN files at a time (0 = one per processor, default = %d)\n", defaultBatchCount);
 	fprintf(stderr, "       -dNNN store all output images in directory NNN.\n");
+	fprintf(stderr, "       -g    deferred rendering (light the scene once, then just apply each texture)\n");
 	fprintf(stderr, "       -h    this help\n");
+	fprintf(stderr, "       -jNNN render with NNN threads (0 = one per processor, default = %d)\n", defaultThreadCount);
 	fprintf(stderr, "       -p    pause and wait for a key on error\n");
 	fprintf(stderr, "       -qNNN set the output JPEG quality to NNN (0...100, default = %d)\n", defaultJPEGQuality);
 	fprintf(stderr, "       -r    recurse through subdirectories of <input specification>\n");
@@ -87,11 +98,27 @@ static	void	printUsage(const char * argv0)
 	fprintf(stderr, "       -uNNN set oversample (Y direction only) to NNN (1...16, default = %d)\n", defaultOversampleY);
 	fprintf(stderr, "       -xNNN render width (default = %d)\n", defaultRenderWidth);
 	fprintf(stderr, "       -yNNN render height (default = %d)\n", defaultRenderHeight);
+	fprintf(stderr, "       --stats      print timing and counters for each file and the batch\n");
+	fprintf(stderr, "       --stats=json same, as JSON (one object per line)\n");
+	fprintf(stderr, "       --simd=NNN   shade with NNN: 'scalar', 'sse2' or 'avx2' (default = %s)\n", spanShaderName(SPAN_SCALAR));
+	fprintf(stderr, "       --raster=NNN rasterize with NNN: 'scanline' or 'halfspace' (default = %s)\n", rasterizerName(RASTER_SCANLINE));
+	fprintf(stderr, "       --hiz=off    don't skip hidden polygons with a hierarchical z-buffer\n");
+	fprintf(stderr, "       --hiz=shadows use one for the shadow maps too\n");
+	fprintf(stderr, "       --depth-prepass draw the depths first, then shade only the visible pixels\n");
+	fprintf(stderr, "       --bvh=off    cull whole meshes rather than the nodes of the scene's BVH\n");
+	fprintf(stderr, "       --weld=NNN   weld scene vertices within NNN of each other ('off' = don't\n");
+	fprintf(stderr, "                    weld, default = 0: only identical vertices)\n");
+	fprintf(stderr, "       --save-welded=NNN save a copy of the scene file with the welded meshes as NNN\n");
+	fprintf(stderr, "       --compile-scene compile the scene file into a .tbscene file (see below)\n");
+	fprintf(stderr, "       --shadow-cache[=NNN] cache the shadow maps in file NNN (default = the scene\n");
+	fprintf(stderr, "                    filename, with a .tbshadow extension)\n");
+	fprintf(stderr, "       --shadows=rays trace hard shadows through the scene's BVH instead of\n");
+	fprintf(stderr, "                    rendering shadow maps\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Shadow map options:\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "	-iBNNN set shadow map bias to NNN (default = %f)\n", defaultShadowMapBias);
-	fprintf(stderr, "	-iRNNN set shadow map resolution to NNN (default = %d)\n", defaultShadowMapRes);
+	fprintf(stderr, "	-iRNNN set shadow map resolution to NNN (0 = no shadows, default = %d)\n", defaultShadowMapRes);
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Phong illumination options:\n");
 	fprintf(stderr, "\n");
@@ -124,6 +151,84 @@ static	void	printUsage(const char * argv0)
 	fprintf(stderr, "   Note that this can really slow things down with large values. For example,\n");
 	fprintf(stderr, "   16x16 oversampling causes the image to be rendered 256 times.\n");
 	fprintf(stderr, "\n");
+	fprintf(stderr, "   Multisampling (-ams) uses the same oversample values, but only renders the\n");
+	fprintf(stderr, "   scene once. Each polygon is shaded once per pixel, with the result shared\n");
+	fprintf(stderr, "   by all of the subsamples it covers, so it's much faster than supersampling\n");
+	fprintf(stderr, "   with the same quality edges. Texture & lighting detail is not antialiased.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   Adaptive supersampling (-aad) renders the scene once, finds the pixels on\n");
+	fprintf(stderr, "   the edges of the geometry and only supersamples those. This gives nearly the\n");
+	fprintf(stderr, "   same edge quality as supersampling, for a fraction of the cost.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The antialiasing mode is ignored for deferred rendering.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   Deferred rendering (-g) is much faster when rendering many textures, since\n");
+	fprintf(stderr, "   the scene is only rendered once. It stores every oversample render of the\n");
+	fprintf(stderr, "   lit scene, so it uses a lot of memory with large images and oversampling.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   Rendering with multiple threads (-j) produces exactly the same images as\n");
+	fprintf(stderr, "   rendering with a single thread. The scene's shadow maps are rendered with\n");
+	fprintf(stderr, "   -j threads too, several lights at once (and in bands, for fewer lights.)\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   Batches of many small images are usually faster to render a few files at\n");
+	fprintf(stderr, "   a time (-b) than a single file with many threads. Each file being rendered\n");
+	fprintf(stderr, "   gets its own -j threads. Deferred batches light the scene once, up front,\n");
+	fprintf(stderr, "   and every file shares that G-buffer.\n");
+	fprintf(stderr, "   Batches are pipelined: while rendering, the next textures are read and the\n");
+	fprintf(stderr, "   finished images are written. Up to -b files wait to be rendered and -b\n");
+	fprintf(stderr, "   more wait to be written, so the memory used grows with -b. A single line\n");
+	fprintf(stderr, "   is printed as each file is written.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   Statistics (--stats) are printed to stdout for the scene, for each file as\n");
+	fprintf(stderr, "   it's written and for the whole batch at the end. With --stats=json, each\n");
+	fprintf(stderr, "   report is a single line starting with '{', so they're easy to pick out of\n");
+	fprintf(stderr, "   the progress output. The CPU times are for the whole process, so when a\n");
+	fprintf(stderr, "   batch is pipelined, the files overlap and only the batch totals add up.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The default shader (--simd) is the scalar one. The SIMD shaders shade\n");
+	fprintf(stderr, "   several pixels at once and are much faster, but their images can differ\n");
+	fprintf(stderr, "   from the scalar shader's by a shade here and there, so they're opt-in\n");
+	fprintf(stderr, "   (--simd=%s is the fastest this processor supports.)\n", spanShaderName(bestSpanShader()));
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The half-space rasterizer (--raster) tests the polygons against 8x8 blocks\n");
+	fprintf(stderr, "   of pixels rather than walking their edges. It's there to be compared with\n");
+	fprintf(stderr, "   the scanline rasterizer; its images only differ right at polygon edges.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The hierarchical z-buffer keeps the farthest depth of each 8x8 block of\n");
+	fprintf(stderr, "   pixels, so polygons (and spans) that are hidden behind what's already been\n");
+	fprintf(stderr, "   drawn are skipped without being shaded. It never changes the images (--hiz=off\n");
+	fprintf(stderr, "   is only there for comparison.) The shadow maps only store depths, which are\n");
+	fprintf(stderr, "   cheaper to draw than to skip, so they only use it with --hiz=shadows.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The depth pre-pass (--depth-prepass) draws each pass twice: the depths\n");
+	fprintf(stderr, "   alone, then the shading, so every pixel is lit just once however much the\n");
+	fprintf(stderr, "   scene overdraws. Its images only differ right where polygons meet, and\n");
+	fprintf(stderr, "   --stats shows how many pixels it saved from being shaded.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   A BVH (a tree of bounding boxes) is built over the scene as it's loaded.\n");
+	fprintf(stderr, "   Each render, and each light's shadow map, only transforms the geometry in\n");
+	fprintf(stderr, "   the boxes it can see (and, for a light, within its range), nearest first.\n");
+	fprintf(stderr, "   With --shadows=rays, each pixel traces a ray through the BVH to each light\n");
+	fprintf(stderr, "   instead of looking up a shadow map, so the shadows are exact but hard-edged.\n");
+	fprintf(stderr, "   Each ray skips the first -iB units (the shadow map bias) of its path. It's\n");
+	fprintf(stderr, "   slower than the shadow maps (and the SIMD shaders aren't used), but there's\n");
+	fprintf(stderr, "   nothing to render or cache up front.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The scene's vertices are welded as it's loaded, since some exporters leave\n");
+	fprintf(stderr, "   duplicates behind. A scene saved with --save-welded renders exactly like\n");
+	fprintf(stderr, "   the welded scene did, and can be used with --weld=off to skip the welding.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   A compiled scene (--compile-scene) is written next to the scene file, with\n");
+	fprintf(stderr, "   a .tbscene extension, and holds the imported scene ready to render. It's\n");
+	fprintf(stderr, "   used in place of the scene file from then on, as long as the scene file\n");
+	fprintf(stderr, "   hasn't changed and the --weld setting is the same. A .tbscene file can also\n");
+	fprintf(stderr, "   be given to -s directly. With no input specification, --compile-scene just\n");
+	fprintf(stderr, "   compiles the scene and exits.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "   The shadow cache (--shadow-cache) holds the scene's shadow maps. They're\n");
+	fprintf(stderr, "   read from it if they match the scene's geometry, its lights and the shadow\n");
+	fprintf(stderr, "   map resolution (-iR). Otherwise they're rendered and the cache is updated.\n");
+	fprintf(stderr, "\n");
 	fprintf(stderr, "   The program will return '0' on error, and '1' on success.\n");
 
 	// Cause an error-free immediate exit from the program
@@ -322,17 +427,287 @@ static	void	parseInputSpecifications(const std::vector<std::string> & inputSpeci
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+static	std::string	outputFilename(const std::string & inputFilename, const std::string & destinationDirectory)
+{
+	std::string	outputName = inputFilename;
+
+	if (destinationDirectory.length())
+	{
+		std::string::size_type	idx = outputName.rfind(fileSystemSlash);
+		if (idx != std::string::npos) outputName.erase(0, idx+1);
+		outputName = std::string(destinationDirectory).append(outputName);
+	}
+
+	// No destination directory, append '-rendered' into the filename
+
+	else
+	{
+		outputName.insert(outputName.length() - 4, "-rendered");
+	}
+
+	return outputName;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static	void	printStats(const Stats & stats, const bool json)
+{
+	// Human-readable reports already end with a newline
+
+	if (json)	printf("%s\n", stats.report(true).c_str());
+	else		printf("%s", stats.report(false).c_str());
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Renders a batch of files as a three stage pipeline: task 0 reads (decodes) the textures, task 1 writes (encodes) the rendered
+// images and the rest of the tasks render them, each with its own renderer. The stages are connected by bounded queues, so the
+// decoding and encoding are done while rendering and the number of files in flight (and the memory they use) is bounded. Every
+// task runs for the whole batch, so the pool needs a thread for each task.
+//
+// Errors can't be thrown across threads, so the first one is kept (and the queues are closed to shut the pipeline down) to be
+// thrown once the batch is done.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	unsigned int	index;
+	Jpeg *		texture;
+	Jpeg *		image;
+	Stats		stats;
+} sBATCHITEM;
+
+class	BatchJob : public ThreadJob
+{
+public:
+virtual		void		run(const unsigned int task, const unsigned int thread)
+		{
+			if (task == 0)		decode();
+			else if (task == 1)	encode();
+			else			render(*renders[task - 2]);
+		}
+
+		// Stage 1: read the textures, in order
+
+		void		decode()
+		{
+			for (unsigned int i = 0; i < filenames->size() && !hasFailed(); ++i)
+			{
+				sBATCHITEM *	item = newItem(i);
+				try
+				{
+					if (statsEnabled)
+					{
+						item->stats.name() = (*filenames)[i];
+						item->stats.files() = 1;
+						item->stats.begin(Stats::STAGE_TOTAL);
+					}
+
+					StageTimer	timer(statsEnabled ? &item->stats : NULL, Stats::STAGE_READ);
+					item->texture = new Jpeg;
+					item->texture->read((*filenames)[i]);
+				}
+				catch(const std::string & err)
+				{
+					deleteItem(item);
+					fail(err);
+					break;
+				}
+				catch(...)
+				{
+					deleteItem(item);
+					fail("Unknown error (possibly out of memory) reading " + (*filenames)[i]);
+					break;
+				}
+
+				if (!decodeQueue->push(item)) deleteItem(item);
+			}
+
+			decodeQueue->close();
+		}
+
+		// Stage 2: render them (the last renderer to finish closes the encode queue)
+
+		void		render(Render & renderer)
+		{
+			void *	ptr;
+			while (decodeQueue->pop(ptr))
+			{
+				sBATCHITEM *	item = reinterpret_cast<sBATCHITEM *>(ptr);
+				if (hasFailed())
+				{
+					deleteItem(item);
+					continue;
+				}
+
+				try
+				{
+					item->image = new Jpeg(width, height);
+					renderer.stats() = statsEnabled ? &item->stats : NULL;
+					if (gBuffer)	renderer.renderTextureDeferred(*item->image, *item->texture, *gBuffer);
+					else		renderer.renderTexture(*item->image, *item->texture, *scene, width, height, oversampleX, oversampleY, *phong);
+				}
+				catch(const std::string & err)
+				{
+					deleteItem(item);
+					fail(err);
+					continue;
+				}
+				catch(...)
+				{
+					std::string	filename = (*filenames)[item->index];
+					deleteItem(item);
+					fail("Unknown error (possibly out of memory) rendering " + filename);
+					continue;
+				}
+
+				// We're done with the texture, don't hang onto it while waiting to be written
+
+				delete item->texture;
+				item->texture = NULL;
+
+				if (!encodeQueue->push(item)) deleteItem(item);
+			}
+
+			pool->lock();
+			bool	last = ++rendersDone == renders.size();
+			pool->unlock();
+			if (last) encodeQueue->close();
+		}
+
+		// Stage 3: write the images, in the order they're finished
+
+		void		encode()
+		{
+			void *	ptr;
+			while (encodeQueue->pop(ptr))
+			{
+				sBATCHITEM *	item = reinterpret_cast<sBATCHITEM *>(ptr);
+				if (!hasFailed())
+				{
+					std::string	outputName = outputFilename((*filenames)[item->index], *destinationDirectory);
+					try
+					{
+						{
+							StageTimer	timer(statsEnabled ? &item->stats : NULL, Stats::STAGE_WRITE);
+							item->image->write(outputName, quality);
+						}
+
+						// Progress -- one complete line per file (followed by its stats)
+
+						pool->lock();
+						try
+						{
+							printf("(%d of %d) %s\n", ++filesDone, static_cast<unsigned int>(filenames->size()), outputName.c_str());
+							if (statsEnabled)
+							{
+								item->stats.end(Stats::STAGE_TOTAL);
+								printStats(item->stats, json);
+								total->add(item->stats);
+							}
+						}
+						catch(...)
+						{
+							// fail() takes the lock too
+
+							pool->unlock();
+							throw;
+						}
+						pool->unlock();
+					}
+					catch(const std::string & err)
+					{
+						fail(err);
+					}
+					catch(...)
+					{
+						fail("Unknown error (possibly out of memory) writing " + outputName);
+					}
+				}
+				deleteItem(item);
+			}
+		}
+
+		// Remembers the first error, and shuts the pipeline down
+
+		void		fail(const std::string & err)
+		{
+			pool->lock();
+			if (!failed) error = err;
+			failed = true;
+			pool->unlock();
+
+			decodeQueue->close();
+			encodeQueue->close();
+		}
+
+		bool		hasFailed()
+		{
+			pool->lock();
+			bool	result = failed;
+			pool->unlock();
+			return result;
+		}
+
+static		sBATCHITEM *	newItem(const unsigned int index)
+		{
+			sBATCHITEM *	item = new sBATCHITEM;
+			item->index = index;
+			item->texture = NULL;
+			item->image = NULL;
+			return item;
+		}
+
+static		void		deleteItem(sBATCHITEM * item)
+		{
+			delete item->texture;
+			delete item->image;
+			delete item;
+		}
+
+		ThreadPool *		pool;
+		ThreadQueue *		decodeQueue;
+		ThreadQueue *		encodeQueue;
+		std::vector<Render *>	renders;
+		Scene *			scene;
+	const	std::vector<std::string> *	filenames;
+	const	std::string *		destinationDirectory;
+	const	GBuffer *		gBuffer;	// The lit scene, shared by the renderers (when deferred)
+		unsigned int		width;
+		unsigned int		height;
+		unsigned int		oversampleX;
+		unsigned int		oversampleY;
+		unsigned int		quality;
+	const	sPHONG *		phong;
+		bool			statsEnabled;
+		bool			json;
+		Stats *			total;		// The batch summary
+		unsigned int		rendersDone;
+		unsigned int		filesDone;
+		bool			failed;
+		std::string		error;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
 int	main(const int argc, const char * argv[])
 {
 	// Command line parameters and their defaults
 
 	bool				pauseOnError = false;
+	bool				deferred = false;
 	bool				recurse = false;
+	bool				statsEnabled = false;
+	bool				statsJSON = false;
+	bool				depthPrepass = false;
+	bool				shadowRays = false;
+	Render::AntialiasMode		antialiasMode = Render::AA_SUPERSAMPLE;
 	unsigned int			jpegQuality = defaultJPEGQuality;
 	unsigned int			renderWidth = defaultRenderWidth;
 	unsigned int			renderHeight = defaultRenderHeight;
 	unsigned int			oversampleX = defaultOversampleX;
 	unsigned int			oversampleY = defaultOversampleY;
+	unsigned int			threadCount = defaultThreadCount;
+	unsigned int			batchCount = defaultBatchCount;
 	float				Ka = defaultKa;
 	float				Kd = defaultKd;
 	float				Ks = defaultKs;
@@ -342,9 +717,16 @@ int	main(const int argc, const char * argv[])
 	Point3				ambientColor = defaultAmbientColor;
 	Point3				specularColor = defaultSpecularColor;
 	std::string			sceneFilename = defaultSceneFilename;
+	sWELD				weld;
+	bool				compileScene = false;
+	bool				shadowCache = false;
+	std::string			shadowCacheFilename;
 	std::string			destinationDirectory;
 	std::vector<std::string>	inputSpecifications;
 
+	weld.enabled = true;
+	weld.tolerance = 0;
+
 #ifndef _MSC_VER
 	setbuf(stdout, 0);
 #endif
@@ -365,12 +747,40 @@ int	main(const int argc, const char * argv[])
 			{
 				switch(tolower(argv[i][1]))
 				{
+					case 'a':
+						if (!stricmp(&argv[i][2], "ss"))
+						{
+							antialiasMode = Render::AA_SUPERSAMPLE;
+						}
+						else if (!stricmp(&argv[i][2], "ms"))
+						{
+							antialiasMode = Render::AA_MULTISAMPLE;
+						}
+						else if (!stricmp(&argv[i][2], "ad"))
+						{
+							antialiasMode = Render::AA_ADAPTIVE;
+						}
+						else
+						{
+							fprintf(stderr, "Unknown antialiasing mode: %s\n\n", argv[i]);
+							printUsage(argv[0]);
+						}
+						break;
+
+					case 'b':
+						batchCount = atoi(&argv[i][2]);
+						break;
+
 					case 'd':
 						destinationDirectory = &argv[i][2];
 						if (destinationDirectory.length() && destinationDirectory[destinationDirectory.length()-1] != fileSystemSlash)
 							destinationDirectory += fileSystemSlash;
 						break;
 
+					case 'g':
+						deferred = true;
+						break;
+
 					case 'h':
 						printUsage(argv[0]);
 						break;
@@ -432,6 +842,10 @@ int	main(const int argc, const char * argv[])
 
 						break;
 
+					case 'j':
+						threadCount = atoi(&argv[i][2]);
+						break;
+
 					case 'p':
 						pauseOnError = true;
 						break;
@@ -464,6 +878,102 @@ int	main(const int argc, const char * argv[])
 						renderHeight = atoi(&argv[i][2]);
 						break;
 
+					case '-':
+						if (!stricmp(&argv[i][2], "stats"))
+						{
+							statsEnabled = true;
+							statsJSON = false;
+						}
+						else if (!stricmp(&argv[i][2], "stats=json"))
+						{
+							statsEnabled = true;
+							statsJSON = true;
+						}
+						else if (!strncmp(&argv[i][2], "simd=", 5))
+						{
+							bool	found = false;
+							for (unsigned int j = 0; j < SPAN_SHADER_COUNT && !found; ++j)
+							{
+								if (stricmp(&argv[i][7], spanShaderName(static_cast<SpanShader>(j)))) continue;
+								setSpanShader(static_cast<SpanShader>(j));
+								found = true;
+							}
+
+							if (!found)
+							{
+								fprintf(stderr, "Unknown span shader: %s\n\n", &argv[i][7]);
+								printUsage(argv[0]);
+							}
+						}
+						else if (!strncmp(&argv[i][2], "raster=", 7))
+						{
+							bool	found = false;
+							for (unsigned int j = 0; j < RASTERIZER_COUNT && !found; ++j)
+							{
+								if (stricmp(&argv[i][9], rasterizerName(static_cast<Rasterizer>(j)))) continue;
+								setRasterizer(static_cast<Rasterizer>(j));
+								found = true;
+							}
+
+							if (!found)
+							{
+								fprintf(stderr, "Unknown rasterizer: %s\n\n", &argv[i][9]);
+								printUsage(argv[0]);
+							}
+						}
+						else if (!stricmp(&argv[i][2], "hiz=off"))
+						{
+							setHierarchicalZ(false);
+						}
+						else if (!stricmp(&argv[i][2], "hiz=shadows"))
+						{
+							setShadowMapHiZ(true);
+						}
+						else if (!stricmp(&argv[i][2], "depth-prepass"))
+						{
+							depthPrepass = true;
+						}
+						else if (!stricmp(&argv[i][2], "bvh=off"))
+						{
+							setBvhCulling(false);
+						}
+						else if (!stricmp(&argv[i][2], "shadows=rays"))
+						{
+							shadowRays = true;
+						}
+						else if (!stricmp(&argv[i][2], "weld=off"))
+						{
+							weld.enabled = false;
+						}
+						else if (!strncmp(&argv[i][2], "weld=", 5))
+						{
+							weld.enabled = true;
+							weld.tolerance = static_cast<float>(atof(&argv[i][7]));
+						}
+						else if (!strncmp(&argv[i][2], "save-welded=", 12))
+						{
+							weld.saveFilename = &argv[i][14];
+						}
+						else if (!stricmp(&argv[i][2], "compile-scene"))
+						{
+							compileScene = true;
+						}
+						else if (!stricmp(&argv[i][2], "shadow-cache"))
+						{
+							shadowCache = true;
+						}
+						else if (!strncmp(&argv[i][2], "shadow-cache=", 13))
+						{
+							shadowCache = true;
+							shadowCacheFilename = &argv[i][15];
+						}
+						else
+						{
+							fprintf(stderr, "Unknown command line option: %s\n\n", argv[i]);
+							printUsage(argv[0]);
+						}
+						break;
+
 					default:
 						fprintf(stderr, "Unknown command line option: %s\n\n", argv[i]);
 						printUsage(argv[0]);
@@ -476,6 +986,15 @@ int	main(const int argc, const char * argv[])
 			}
 		}
 
+		// Compile the scene first, if asked to (that may be all they want)
+
+		if (compileScene)
+		{
+			Scene	compiled;
+			compiled.compile(sceneFilename, weld);
+			if (!inputSpecifications.size()) return 1;
+		}
+
 		// Make sure we have an input specification
 
 		if (!inputSpecifications.size())
@@ -503,6 +1022,10 @@ int	main(const int argc, const char * argv[])
 		std::vector<std::string>	processFilenames;
 		parseInputSpecifications(inputSpecifications, recurse, processFilenames);
 
+		// Nothing to render (an empty directory, say.) The batch pipeline needs at least one renderer to shut itself down.
+
+		if (processFilenames.empty()) return 1;
+
 		// Setup the phong options
 
 		sPHONG	phong;
@@ -514,27 +1037,131 @@ int	main(const int argc, const char * argv[])
 		phong.specularColor = specularColor;
 		phong.shadowMapBias = shadowMapBias;
 		phong.shadowMapRes = shadowMapRes;
+		phong.shadowRays = shadowRays;
+
+		// The batch summary covers everything from here on (including the scene)
 
-		for (unsigned int i = 0; i < processFilenames.size(); ++i)
+		Stats	batchStats;
+		batchStats.name() = "batch";
+		batchStats.begin(Stats::STAGE_TOTAL);
+
+		// Load the scene once for the whole batch -- only the texture changes from one file to the next
+
+		Stats	sceneStats;
+		sceneStats.name() = "scene";
+
+		Scene	scene;
+		if (shadowCache && !shadowCacheFilename.length()) shadowCacheFilename = Scene::shadowCacheFilename(sceneFilename);
+		scene.load(sceneFilename, weld, phong, shadowCacheFilename, threadCount, statsEnabled ? &sceneStats : NULL);
+
+		if (statsEnabled)
 		{
-			Render		render;
-			std::string	outputName = processFilenames[i];
+			printStats(sceneStats, statsJSON);
+			batchStats.add(sceneStats);
+		}
+
+		// A single file is simply rendered (with the usual progress)
 
-			if (destinationDirectory.length())
+		if (processFilenames.size() == 1)
+		{
+			Render	render;
+			render.threads().start(threadCount);
+			render.antialiasMode() = antialiasMode;
+			render.depthPrepass() = depthPrepass;
+
+			Stats	fileStats;
+			fileStats.name() = processFilenames[0];
+			fileStats.files() = 1;
+			if (statsEnabled) render.stats() = &fileStats;
+
+			std::string	outputName = outputFilename(processFilenames[0], destinationDirectory);
+			if (deferred)	render.renderSceneDeferred(processFilenames[0], outputName, scene, renderWidth, renderHeight, oversampleX, oversampleY, jpegQuality, phong);
+			else		render.renderScene(processFilenames[0], outputName, scene, renderWidth, renderHeight, oversampleX, oversampleY, jpegQuality, phong);
+
+			if (statsEnabled)
 			{
-				std::string::size_type	idx = outputName.rfind(fileSystemSlash);
-				if (idx != std::string::npos) outputName.erase(0, idx+1);
-				outputName = std::string(destinationDirectory).append(outputName);
+				batchStats.end(Stats::STAGE_TOTAL);
+				batchStats.add(fileStats);
+				printStats(fileStats, statsJSON);
+				printStats(batchStats, statsJSON);
 			}
+			return 1;
+		}
 
-			// No destination directory, append '-rendered' into the filename
+		// Otherwise, pipeline the batch -- a few files at a time (there's no point in rendering more files at once than
+		// there are files) with a file's worth of room in the queues for each of them
 
-			else
+		if (!batchCount) batchCount = ThreadPool::processorCount();
+		if (batchCount > processFilenames.size()) batchCount = static_cast<unsigned int>(processFilenames.size());
+
+		// Deferred batches light the scene once, and the renderers all shade from that (they only read it)
+
+		Render	lighting;
+		if (deferred)
+		{
+			Stats	lightingStats;
+			lightingStats.name() = "lighting";
+
+			lighting.threads().start(threadCount);
+			lighting.verbose() = false;
+			lighting.stats() = statsEnabled ? &lightingStats : NULL;
+			lighting.lightScene(scene, renderWidth, renderHeight, oversampleX, oversampleY, phong);
+			lighting.stats() = NULL;
+
+			if (statsEnabled)
 			{
-				outputName.insert(outputName.length() - 4, "-rendered");
+				printStats(lightingStats, statsJSON);
+				batchStats.add(lightingStats);
 			}
+		}
+
+		ThreadQueue	decodeQueue(batchCount);
+		ThreadQueue	encodeQueue(batchCount);
+
+		BatchJob	job;
+		job.decodeQueue = &decodeQueue;
+		job.encodeQueue = &encodeQueue;
+		job.scene = &scene;
+		job.filenames = &processFilenames;
+		job.destinationDirectory = &destinationDirectory;
+		job.gBuffer = deferred ? &lighting.gBuffer() : NULL;
+		job.width = renderWidth;
+		job.height = renderHeight;
+		job.oversampleX = oversampleX;
+		job.oversampleY = oversampleY;
+		job.quality = jpegQuality;
+		job.phong = &phong;
+		job.statsEnabled = statsEnabled;
+		job.json = statsJSON;
+		job.total = &batchStats;
+		job.rendersDone = 0;
+		job.filesDone = 0;
+		job.failed = false;
+
+		for (unsigned int i = 0; i < batchCount; ++i)
+		{
+			Render *	render = new Render;
+			job.renders.push_back(render);
+			render->threads().start(threadCount);
+			render->antialiasMode() = antialiasMode;
+			render->depthPrepass() = depthPrepass;
+			render->verbose() = false;
+		}
+
+		// One thread for each stage task (decode, encode and each renderer)
 
-			render.renderScene(processFilenames[i], outputName, sceneFilename, renderWidth, renderHeight, oversampleX, oversampleY, jpegQuality, phong);
+		ThreadPool	batch;
+		batch.start(batchCount + 2);
+		job.pool = &batch;
+		batch.run(job, batchCount + 2);
+
+		for (unsigned int i = 0; i < job.renders.size(); ++i) delete job.renders[i];
+		if (job.failed) throw job.error;
+
+		if (statsEnabled)
+		{
+			batchStats.end(Stats::STAGE_TOTAL);
+			printStats(batchStats, statsJSON);
 		}
 	}
 	catch(const std::string & err)
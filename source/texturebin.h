@@ -42,6 +42,7 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <algorithm>
 
 #ifndef _MSC_VER
 #include <unistd.h>
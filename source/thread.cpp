@@ -0,0 +1,444 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  _______ _                         _                      
+// |__   __| |                       | |                     
+//    | |  | |__  _ __  ___  __ _  __| |     ___ _ __  _ __  
+//    | |  | '_ \| '__|/ _ \/ _` |/ _` |    / __| '_ \| '_ \ 
+//    | |  | | | | |  |  __/ (_| | (_| | _ | (__| |_) | |_) |
+//    |_|  |_| |_|_|   \___|\__,_|\__,_|(_) \___| .__/| .__/ 
+//                                              | |   | |    
+//                                              |_|   |_|    
+//
+// Description:
+//
+//   A very simple pool of worker threads
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#include "texturebin.h"
+#include "thread.h"
+
+#ifdef _MSC_VER
+#include <process.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	ThreadPool::ThreadPool()
+	: _threadCount(1), _job(NULL), _taskCount(0), _nextTask(0), _generation(0), _busyWorkers(0), _quit(false)
+{
+#ifdef _MSC_VER
+	InitializeCriticalSection(&_mutex);
+	_doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+#else
+	pthread_mutex_init(&_mutex, NULL);
+	pthread_cond_init(&_workCond, NULL);
+	pthread_cond_init(&_doneCond, NULL);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	ThreadPool::~ThreadPool()
+{
+	stop();
+
+#ifdef _MSC_VER
+	CloseHandle(_doneEvent);
+	DeleteCriticalSection(&_mutex);
+#else
+	pthread_cond_destroy(&_doneCond);
+	pthread_cond_destroy(&_workCond);
+	pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	ThreadPool::start(const unsigned int count)
+{
+	stop();
+
+	_threadCount = count ? count : processorCount();
+	if (!_threadCount) _threadCount = 1;
+
+	// The calling thread is thread 0, so we only need to create the rest. Note that the worker list must not be resized once
+	// the threads are running, since they hold pointers into it.
+
+	_quit = false;
+	_workers.resize(_threadCount - 1);
+	for (unsigned int i = 0; i < _workers.size(); ++i)
+	{
+		sWORKER &	worker = _workers[i];
+		worker.pool = this;
+		worker.thread = i + 1;
+		worker.generation = _generation;
+
+#ifdef _MSC_VER
+		worker.wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+		worker.handle = reinterpret_cast<HANDLE>(_beginthreadex(NULL, 0, workerEntry, &worker, 0, NULL));
+		if (!worker.handle) throw std::string("Unable to create a worker thread");
+#else
+		if (pthread_create(&worker.handle, NULL, workerEntry, &worker)) throw std::string("Unable to create a worker thread");
+#endif
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	ThreadPool::stop()
+{
+	if (!_workers.size()) return;
+
+	// Tell everybody to go home
+
+#ifdef _MSC_VER
+	EnterCriticalSection(&_mutex);
+	_quit = true;
+	LeaveCriticalSection(&_mutex);
+
+	for (unsigned int i = 0; i < _workers.size(); ++i)
+	{
+		SetEvent(_workers[i].wake);
+		WaitForSingleObject(_workers[i].handle, INFINITE);
+		CloseHandle(_workers[i].handle);
+		CloseHandle(_workers[i].wake);
+	}
+#else
+	pthread_mutex_lock(&_mutex);
+	_quit = true;
+	pthread_cond_broadcast(&_workCond);
+	pthread_mutex_unlock(&_mutex);
+
+	for (unsigned int i = 0; i < _workers.size(); ++i)
+	{
+		pthread_join(_workers[i].handle, NULL);
+	}
+#endif
+
+	_workers.clear();
+	_threadCount = 1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	ThreadPool::run(ThreadJob & job, const unsigned int taskCount)
+{
+	// Without any workers, just run the tasks in order
+
+	if (!_workers.size())
+	{
+		for (unsigned int i = 0; i < taskCount; ++i) job.run(i, 0);
+		return;
+	}
+
+	// Hand the job to the workers
+
+#ifdef _MSC_VER
+	EnterCriticalSection(&_mutex);
+#else
+	pthread_mutex_lock(&_mutex);
+#endif
+
+	_job = &job;
+	_taskCount = taskCount;
+	_nextTask = 0;
+	_busyWorkers = static_cast<unsigned int>(_workers.size());
+	++_generation;
+
+#ifdef _MSC_VER
+	LeaveCriticalSection(&_mutex);
+	for (unsigned int i = 0; i < _workers.size(); ++i) SetEvent(_workers[i].wake);
+#else
+	pthread_cond_broadcast(&_workCond);
+	pthread_mutex_unlock(&_mutex);
+#endif
+
+	// Pitch in
+
+	work(0);
+
+	// Wait for the stragglers
+
+#ifdef _MSC_VER
+	EnterCriticalSection(&_mutex);
+	while (_busyWorkers)
+	{
+		LeaveCriticalSection(&_mutex);
+		WaitForSingleObject(_doneEvent, INFINITE);
+		EnterCriticalSection(&_mutex);
+	}
+	_job = NULL;
+	LeaveCriticalSection(&_mutex);
+#else
+	pthread_mutex_lock(&_mutex);
+	while (_busyWorkers) pthread_cond_wait(&_doneCond, &_mutex);
+	_job = NULL;
+	pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	ThreadPool::lock()
+{
+#ifdef _MSC_VER
+	EnterCriticalSection(&_mutex);
+#else
+	pthread_mutex_lock(&_mutex);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	ThreadPool::unlock()
+{
+#ifdef _MSC_VER
+	LeaveCriticalSection(&_mutex);
+#else
+	pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+unsigned int	ThreadPool::processorCount()
+{
+#ifdef _MSC_VER
+	SYSTEM_INFO	info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long	count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? static_cast<unsigned int>(count) : 1;
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	ThreadPool::work(const unsigned int thread)
+{
+	for(;;)
+	{
+		// Grab the next task
+
+		lock();
+		unsigned int	task = _nextTask < _taskCount ? _nextTask++ : _taskCount;
+		unlock();
+
+		if (task == _taskCount) break;
+
+		_job->run(task, thread);
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+unsigned int __stdcall	ThreadPool::workerEntry(void * arg)
+{
+	sWORKER &	worker = *reinterpret_cast<sWORKER *>(arg);
+	ThreadPool &	pool = *worker.pool;
+
+	for(;;)
+	{
+		// Wait for a job (or to be told to quit)
+
+		WaitForSingleObject(worker.wake, INFINITE);
+		EnterCriticalSection(&pool._mutex);
+		bool	quit = pool._quit;
+		LeaveCriticalSection(&pool._mutex);
+		if (quit) break;
+
+		pool.work(worker.thread);
+
+		// Let the pool know we're done
+
+		EnterCriticalSection(&pool._mutex);
+		if (!--pool._busyWorkers) SetEvent(pool._doneEvent);
+		LeaveCriticalSection(&pool._mutex);
+	}
+
+	return 0;
+}
+
+#else // LINUX VERSION
+
+void *	ThreadPool::workerEntry(void * arg)
+{
+	sWORKER &	worker = *reinterpret_cast<sWORKER *>(arg);
+	ThreadPool &	pool = *worker.pool;
+
+	pthread_mutex_lock(&pool._mutex);
+	for(;;)
+	{
+		// Wait for a job (or to be told to quit)
+
+		while (pool._generation == worker.generation && !pool._quit) pthread_cond_wait(&pool._workCond, &pool._mutex);
+		if (pool._quit) break;
+		worker.generation = pool._generation;
+		pthread_mutex_unlock(&pool._mutex);
+
+		pool.work(worker.thread);
+
+		// Let the pool know we're done
+
+		pthread_mutex_lock(&pool._mutex);
+		if (!--pool._busyWorkers) pthread_cond_signal(&pool._doneCond);
+	}
+	pthread_mutex_unlock(&pool._mutex);
+
+	return NULL;
+}
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	ThreadQueue::ThreadQueue(const unsigned int capacity)
+	: _capacity(capacity ? capacity : 1), _itemCount(0), _closed(false)
+{
+#ifdef _MSC_VER
+	InitializeCriticalSection(&_mutex);
+	_notFull = CreateEvent(NULL, FALSE, FALSE, NULL);
+	_notEmpty = CreateEvent(NULL, FALSE, FALSE, NULL);
+#else
+	pthread_mutex_init(&_mutex, NULL);
+	pthread_cond_init(&_notFull, NULL);
+	pthread_cond_init(&_notEmpty, NULL);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+	ThreadQueue::~ThreadQueue()
+{
+#ifdef _MSC_VER
+	CloseHandle(_notEmpty);
+	CloseHandle(_notFull);
+	DeleteCriticalSection(&_mutex);
+#else
+	pthread_cond_destroy(&_notEmpty);
+	pthread_cond_destroy(&_notFull);
+	pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	ThreadQueue::push(void * item)
+{
+#ifdef _MSC_VER
+	// The events are auto-reset, so a single wake may stand in for several; whoever wakes passes it along if there's still
+	// something for the next waiter to do
+
+	EnterCriticalSection(&_mutex);
+	while (_itemCount >= _capacity && !_closed)
+	{
+		LeaveCriticalSection(&_mutex);
+		WaitForSingleObject(_notFull, INFINITE);
+		EnterCriticalSection(&_mutex);
+	}
+
+	bool	added = !_closed;
+	if (added)
+	{
+		_items.push_back(item);
+		++_itemCount;
+		SetEvent(_notEmpty);
+	}
+	if (_itemCount < _capacity || _closed) SetEvent(_notFull);
+	LeaveCriticalSection(&_mutex);
+#else
+	pthread_mutex_lock(&_mutex);
+	while (_itemCount >= _capacity && !_closed) pthread_cond_wait(&_notFull, &_mutex);
+
+	bool	added = !_closed;
+	if (added)
+	{
+		_items.push_back(item);
+		++_itemCount;
+		pthread_cond_signal(&_notEmpty);
+	}
+	pthread_mutex_unlock(&_mutex);
+#endif
+
+	return added;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+bool	ThreadQueue::pop(void *& item)
+{
+#ifdef _MSC_VER
+	EnterCriticalSection(&_mutex);
+	while (!_itemCount && !_closed)
+	{
+		LeaveCriticalSection(&_mutex);
+		WaitForSingleObject(_notEmpty, INFINITE);
+		EnterCriticalSection(&_mutex);
+	}
+
+	bool	removed = _itemCount != 0;
+	if (removed)
+	{
+		item = _items.front();
+		_items.pop_front();
+		--_itemCount;
+		SetEvent(_notFull);
+	}
+	if (_itemCount || _closed) SetEvent(_notEmpty);
+	LeaveCriticalSection(&_mutex);
+#else
+	pthread_mutex_lock(&_mutex);
+	while (!_itemCount && !_closed) pthread_cond_wait(&_notEmpty, &_mutex);
+
+	bool	removed = _itemCount != 0;
+	if (removed)
+	{
+		item = _items.front();
+		_items.pop_front();
+		--_itemCount;
+		pthread_cond_signal(&_notFull);
+	}
+	pthread_mutex_unlock(&_mutex);
+#endif
+
+	return removed;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+void	ThreadQueue::close()
+{
+#ifdef _MSC_VER
+	EnterCriticalSection(&_mutex);
+	_closed = true;
+	SetEvent(_notFull);
+	SetEvent(_notEmpty);
+	LeaveCriticalSection(&_mutex);
+#else
+	pthread_mutex_lock(&_mutex);
+	_closed = true;
+	pthread_cond_broadcast(&_notFull);
+	pthread_cond_broadcast(&_notEmpty);
+	pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Thread.cpp - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,206 @@
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  _______ _                         _     _     
+// |__   __| |                       | |   | |    
+//    | |  | |__  _ __  ___  __ _  __| |   | |__  
+//    | |  | '_ \| '__|/ _ \/ _` |/ _` |   | '_ \ 
+//    | |  | | | | |  |  __/ (_| | (_| | _ | | | |
+//    |_|  |_| |_|_|   \___|\__,_|\__,_|(_)|_| |_|
+//                                                
+//                                                
+//
+// Description:
+//
+//   A very simple pool of worker threads
+//
+// Notes:
+//
+//   Best viewed with 8-character tabs and (at least) 132 columns
+//
+// History:
+//
+//   10/17/2026: Original creation
+//
+// Originally released under a custom license.
+// This historical re-release is provided under the MIT License.
+// See the LICENSE file in the repo root for details.
+//
+// https://github.com/nettlep
+//
+// Copyright 2003, Fluid Studios, all rights reserved.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef	_H_THREAD
+#define _H_THREAD
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Module setup (required includes, macros, etc.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A job is a set of independent tasks, numbered [0...count). Each task is run exactly once, by whichever thread gets to it first.
+// The thread number [0...threadCount) is passed along so that jobs can keep per-thread scratch data without any locking.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	ThreadJob
+{
+public:
+virtual					~ThreadJob() {}
+
+virtual		void			run(const unsigned int task, const unsigned int thread) = 0;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	ThreadPool
+{
+public:
+	// Construction/Destruction
+
+					ThreadPool();
+virtual					~ThreadPool();
+
+	// Implementation
+
+	// Start the pool with 'count' threads (including the calling thread, so a count of 1 never creates a thread.) A count
+	// of 0 means one thread per processor.
+
+virtual		void			start(const unsigned int count);
+
+	// Stops (and joins) all worker threads
+
+virtual		void			stop();
+
+	// Runs every task in the job and waits for them all to finish. The calling thread works on tasks too.
+
+virtual		void			run(ThreadJob & job, const unsigned int taskCount);
+
+	// A general purpose lock, for tasks that need to (briefly!) synchronize with each other
+
+		void			lock();
+		void			unlock();
+
+	// Returns the number of processors in the system
+
+static		unsigned int		processorCount();
+
+	// Accessors
+
+inline	const	unsigned int		threadCount() const	{return _threadCount;}
+
+private:
+	// Explicitly disallow copying this object
+
+					ThreadPool(const ThreadPool & rhs) {}
+inline		ThreadPool &		operator=(const ThreadPool & rhs) {ThreadPool * errptr = 0; return *errptr;}
+
+	// Worker threads run tasks from the current job until it's empty
+
+		void			work(const unsigned int thread);
+
+#ifdef _MSC_VER
+static		unsigned int __stdcall	workerEntry(void * arg);
+#else
+static		void *			workerEntry(void * arg);
+#endif
+
+	// Data members
+
+		unsigned int		_threadCount;
+		ThreadJob *		_job;
+		unsigned int		_taskCount;
+		unsigned int		_nextTask;
+		unsigned int		_generation;
+		unsigned int		_busyWorkers;
+		bool			_quit;
+
+		struct	sWORKER
+		{
+			ThreadPool *	pool;
+			unsigned int	thread;
+			unsigned int	generation;	// The last job this worker has picked up
+#ifdef _MSC_VER
+			HANDLE		handle;
+			HANDLE		wake;
+#else
+			pthread_t	handle;
+#endif
+		};
+		std::vector<sWORKER>	_workers;
+
+#ifdef _MSC_VER
+		CRITICAL_SECTION	_mutex;
+		HANDLE			_doneEvent;
+#else
+		pthread_mutex_t		_mutex;
+		pthread_cond_t		_workCond;
+		pthread_cond_t		_doneCond;
+#endif
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A bounded first-in-first-out queue for passing work between threads. Pushing blocks while the queue is full, and popping blocks
+// while it's empty. Once a queue is closed, pushes fail and pops return whatever is left, then fail.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+class	ThreadQueue
+{
+public:
+	// Construction/Destruction
+
+					ThreadQueue(const unsigned int capacity);
+virtual					~ThreadQueue();
+
+	// Implementation
+
+	// Adds an item to the end of the queue, waiting for room if it's full. Returns false (and the item is not added) if the
+	// queue is closed.
+
+virtual		bool			push(void * item);
+
+	// Removes an item from the front of the queue, waiting for one if it's empty. Returns false if the queue is closed and
+	// there's nothing left in it.
+
+virtual		bool			pop(void *& item);
+
+	// Closes the queue, waking anybody that is waiting on it
+
+virtual		void			close();
+
+	// Accessors
+
+inline	const	unsigned int		capacity() const	{return _capacity;}
+
+private:
+	// Explicitly disallow copying this object
+
+					ThreadQueue(const ThreadQueue & rhs) {}
+inline		ThreadQueue &		operator=(const ThreadQueue & rhs) {ThreadQueue * errptr = 0; return *errptr;}
+
+	// Data members
+
+		unsigned int		_capacity;
+		std::list<void *>	_items;
+		unsigned int		_itemCount;
+		bool			_closed;
+
+#ifdef _MSC_VER
+		CRITICAL_SECTION	_mutex;
+		HANDLE			_notFull;
+		HANDLE			_notEmpty;
+#else
+		pthread_mutex_t		_mutex;
+		pthread_cond_t		_notFull;
+		pthread_cond_t		_notEmpty;
+#endif
+};
+
+#endif // _H_THREAD
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Thread.h - End of file
+// ---------------------------------------------------------------------------------------------------------------------------------
@@ -37,6 +37,7 @@ class	Bitmap;
 class	ShadowMap;
 
 #include "primitive.h"
+#include "span.h"
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Constants
@@ -47,6 +48,11 @@ extern	const	unsigned int	textureHeight;
 extern	const	unsigned int	subShift;
 extern	const	unsigned int	subSpan;
 
+// The size of a hierarchical z-buffer tile (see sHIZ), in pixels each way
+
+static	const	unsigned int	hiZTileShift = 3;
+static	const	unsigned int	hiZTileSize = 1 << hiZTileShift;
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 typedef	struct vertex
@@ -58,7 +64,6 @@ typedef	struct vertex
 	Point4	world;
 	Vector3	normal;
 	int	polygonID;
-	struct	vertex *next;
 } sVERT;
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -82,9 +87,45 @@ typedef	struct
 	float	Sh; // Shininess
 	float	shadowMapBias;
 	int	shadowMapRes;
+	bool	shadowRays; // Trace a ray to each light through the scene's BVH, rather than using shadow maps
 	Point3	ambientColor;
 	Point3	specularColor;
 } sPHONG;
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A single (sub)sample of a deferred render. The texture coordinate is normalized (0...1) so that the same G-buffer can be used
+// for textures of any size. The final color is (texel * diffuseScale + specularTerm). Uncovered samples are all zeros, which
+// results in black, just like the standard renderer's cleared frame buffer.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	Point2	texture;
+	Point3	diffuseScale;
+	Point3	specularTerm;
+} sGSAMPLE;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Counters for the rasterizers (see Stats.) They only ever count one polygon (or band) at a time, so 32 bits is plenty.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	unsigned int	tested;		// Pixels (or subsamples, when multisampling) that were depth tested
+	unsigned int	written;	// Pixels that passed the depth test, and were shaded (or written, for a shadow map)
+} sRASTERCOUNT;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Everything the SIMD span shaders need that stays the same for a whole render: the flattened lights, and the version of the shader
+// that's specialized for them (see setupSpanShading.) The function is NULL when the scalar shader is used instead.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	sSPANLIGHT		lights[maxSpanLights];
+	sSHADER			shader;
+	SpanShaderFunction	function;
+} sSPANSHADING;
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 typedef	struct
@@ -97,12 +138,58 @@ typedef	struct
 	Vector3	normal, dnormal;
 } sEDGE;
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The rasterizers used by drawPerspectiveTexturedPolygon() and drawShadowMapPolygon(). The scanline rasterizer walks each polygon's
+// left & right edges, and the half-space rasterizer tests 8x8 blocks of pixels against the polygon's edge functions (see TMap.cpp.)
+// Both draw the same pixels with the same shading, give or take the half-space rasterizer's sub-pixel snapping, so the choice only
+// affects speed. The default is the scanline rasterizer.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+enum	Rasterizer {RASTER_SCANLINE, RASTER_HALFSPACE, RASTERIZER_COUNT};
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A hierarchical z-buffer: a coarse level over a z-buffer, holding the farthest depth (the smallest 1/z) in each tile of pixels.
+// Anything that's no nearer than a tile's farthest depth is hidden everywhere in that tile, so drawPerspectiveTexturedPolygon() and
+// drawShadowMapPolygon() use it to reject whole polygons, and then whole spans, before setting up any of their interpolants.
+//
+// The tiles are only ever a bound on the z-buffer, never more than it: a tile that's drawn to is marked out of date, and brought up
+// to date the next time a polygon that covers it comes along. The tiles are cleared along with the z-buffer, a band of scanlines
+// at a time (clearHiZ), so the bands have to start on a tile boundary (see Render::binPolygons.)
+//
+// Render uses one for its own passes unless setHierarchicalZ(false), and for the shadow maps only if setShadowMapHiZ(true), since
+// depth-only polygons are too cheap for it to pay off (see TMap.cpp.)
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+typedef	struct
+{
+	float *		tiles;		// The farthest depth in each tile (or negative, for a tile that's out of date)
+	float *		zBuffer;
+	unsigned int	width;		// The size of the z-buffer, in pixels
+	unsigned int	height;
+	unsigned int	pitch;		// Tiles per row
+} sHIZ;
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Prototypes
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-void	drawPerspectiveTexturedPolygon(sVERT *verts, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const sPHONG & phong, unsigned int *frameBuffer, unsigned int *textureBuffer, float *zBuffer, const unsigned int pitch, const unsigned int textureWidth, const unsigned int textureHeight);
-void	drawShadowMapPolygon(sVERT *verts, float *zBuffer, const unsigned int pitch);
+void		setRasterizer(const Rasterizer raster);
+Rasterizer	rasterizer();
+const	char *	rasterizerName(const Rasterizer raster);
+void		setHierarchicalZ(const bool enabled);
+bool		hierarchicalZ();
+void		setShadowMapHiZ(const bool enabled);
+bool		shadowMapHiZ();
+void		createHiZ(sHIZ & hiz, float *zBuffer, const unsigned int width, const unsigned int height);
+void		destroyHiZ(sHIZ & hiz);
+void		clearHiZ(sHIZ & hiz, const int top, const int bottom);
+
+Point3	light(const Vector3 & N, const Point4 & view, const Point4 & world, const Point3 & diffuse, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const sPHONG & phong);
+void	setupSpanShading(sSPANSHADING & shading, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const sPHONG & phong, const unsigned int *textureBuffer, const unsigned int textureWidth, const unsigned int textureHeight);
+void	drawPerspectiveTexturedPolygon(sVERT *verts, const unsigned int vertexCount, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const sPHONG & phong, unsigned int *frameBuffer, unsigned int *textureBuffer, float *zBuffer, const unsigned int pitch, const unsigned int textureWidth, const unsigned int textureHeight, const int top, const int bottom, int *idBuffer = NULL, const unsigned char *mask = NULL, sRASTERCOUNT *count = NULL, unsigned int *accumBuffer = NULL, const sSPANSHADING *shading = NULL, sHIZ *hiz = NULL, const int *visible = NULL);
+void	drawGBufferPolygon(sVERT *verts, const unsigned int vertexCount, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const sPHONG & phong, sGSAMPLE *gBuffer, float *zBuffer, const unsigned int pitch, const int top, const int bottom, sRASTERCOUNT *count = NULL);
+void	drawShadowMapPolygon(sVERT *verts, const unsigned int vertexCount, float *zBuffer, const unsigned int pitch, const int top, const int bottom, sRASTERCOUNT *count = NULL, sHIZ *hiz = NULL, int *idBuffer = NULL);
+void	drawMultisampledPolygon(const sVERT *verts, const unsigned int vertexCount, const std::vector<sLIGHT> & lights, const std::vector<ShadowMap> & shadowMaps, const sPHONG & phong, unsigned int *sampleBuffer, float *zBuffer, const unsigned int pitch, const unsigned int *textureBuffer, const unsigned int textureWidth, const unsigned int textureHeight, const unsigned int oversampleX, const unsigned int oversampleY, const int top, const int bottom, sRASTERCOUNT *count = NULL);
 
 #endif
 // ---------------------------------------------------------------------------------------------------------------------------------